@@ -9,7 +9,7 @@ MemoryPoolAllocator::MemoryPoolAllocator(size_t pageSize)
 : slot_(0)
 , pageSize_(pageSize)
 {
-    minAllocSize_ = std::max(sizeof(StringValue), std::max(sizeof(Array), sizeof(Dict)));
+    minAllocSize_ = std::max(sizeof(SharedStringValue), std::max(sizeof(Array), sizeof(Dict)));
 
     const size_t align = sizeof(void*);
     minAllocSize_ = ((minAllocSize_ + align - 1) / align) * align;
@@ -53,6 +53,12 @@ StringValue* MemoryPoolAllocator::createString(const char *str, size_t size, Buf
     }
 }
 
+StringValue* MemoryPoolAllocator::createSharedString(const char *str, size_t size, IRefCout *owner)
+{
+    void *p = this->malloc(sizeof(SharedStringValue));
+    return new (p)SharedStringValue(str, size, owner, this);
+}
+
 ArrayValue* MemoryPoolAllocator::createArray(size_t capacity)
 {
     void *p = this->malloc(sizeof(ArrayValue));
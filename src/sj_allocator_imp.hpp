@@ -18,6 +18,7 @@ public:
     void    free(void *p);
 
     StringValue* createString(const char *str, size_t size, BufferType type) override;
+    StringValue* createSharedString(const char *str, size_t size, IRefCout *owner) override;
     ArrayValue* createArray(size_t capacity) override;
     DictValue* createDict(size_t capacity) override;
     
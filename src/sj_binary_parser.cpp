@@ -1,5 +1,8 @@
 ﻿#include "sj_binary_parser.hpp"
 #include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
 #include <unordered_set>
 #include <fstream>
 #include <sstream>
@@ -72,10 +75,11 @@ bool BinaryParser::doParse()
     if (version_ >= 2)
     {
         size_t reserveSize = readNumber<uint16_t>();
-        for (size_t i = 0; i < reserveSize; ++i)
+        if (reserveSize > (size_t)(end_ - cursor_))
         {
-            stream_->get();
+            return onError(RC_END_OF_FILE);
         }
+        cursor_ += reserveSize;
     }
 
     bool ret = false;
@@ -92,16 +96,94 @@ bool BinaryParser::doParse()
         ret = true;
     } while (0);
 
-    errorOffset_ = (size_t)stream_->tellg();
+    errorOffset_ = (size_t)(cursor_ - begin_);
 
     Array().swap(stringTable_);
     return ret;
 }
 
+/** 非递归地读取一个值，未读取完的容器保存在frames_中，嵌套深度受maxDepth_限制 */
 bool BinaryParser::parseValue(Node &node)
+{
+    const size_t base = frames_.size();
+    Node value;
+    while (true)
+    {
+        size_t count = 0;
+        int ret = parseScalar(value, count);
+        if (ret == 0)
+        {
+            break;
+        }
+
+        if (ret == 2)
+        {
+            if (frames_.size() - base >= maxDepth_)
+            {
+                onError(RC_TOO_DEEP);
+                break;
+            }
+
+            frames_.emplace_back();
+            Frame &frame = frames_.back();
+            frame.node = std::move(value);
+            frame.remaining = count;
+            frame.hasKey = false;
+            continue;
+        }
+
+        // value已经完成，加入父容器。父容器也完成时，继续向上加入
+        while (true)
+        {
+            if (frames_.size() == base)
+            {
+                node = std::move(value);
+                return true;
+            }
+
+            Frame &frame = frames_.back();
+            if (frame.node.isDict())
+            {
+                if (!frame.hasKey)
+                {
+                    frame.key = std::move(value);
+                    frame.hasKey = true;
+                    break;
+                }
+                frame.node.emplaceMember(std::move(frame.key), std::move(value));
+                frame.hasKey = false;
+            }
+            else
+            {
+                frame.node.refArray().push_back(std::move(value));
+            }
+
+            if (--frame.remaining != 0)
+            {
+                break;
+            }
+            value = std::move(frame.node);
+            frames_.pop_back();
+        }
+    }
+
+    // 出错时释放未完成的容器
+    frames_.resize(base);
+    return false;
+}
+
+/** 读取一个值，成功返回1，出错返回0。
+ *  读取到非空的容器时，只创建空的容器，count是元素个数，返回2，由调用者继续读取元素。
+ */
+int BinaryParser::parseScalar(Node &node, size_t &count)
 {
     uint8_t type = readNumber<uint8_t>();
-    bool ret = true;
+    if (errorCode_ != RC_OK)
+    {
+        return 0;
+    }
+
+    int ret = 1;
     switch(type)
     {
         case TP_NONE:
@@ -142,59 +224,59 @@ bool BinaryParser::parseValue(Node &node)
             break;
             
         case TP_STR0:
-            ret = parseString(node, 0);
+            ret = parseString(node, 0) ? 1 : 0;
             break;
         case TP_STR8:
-            ret = parseString(node, readNumber<uint8_t>());
+            ret = parseString(node, readNumber<uint8_t>()) ? 1 : 0;
             break;
         case TP_STR16:
-            ret = parseString(node, readNumber<uint16_t>());
+            ret = parseString(node, readNumber<uint16_t>()) ? 1 : 0;
             break;
         case TP_STR32:
-            ret = parseString(node, readNumber<uint32_t>());
+            ret = parseString(node, readNumber<uint32_t>()) ? 1 : 0;
             break;
             
         case TP_LIST0:
             node.setArray(allocator_);
             break;
         case TP_LIST8:
-            ret = parseArray(node, readNumber<uint8_t>());
+            ret = parseArray(node, readNumber<uint8_t>(), count);
             break;
         case TP_LIST16:
-            ret = parseArray(node, readNumber<uint16_t>());
+            ret = parseArray(node, readNumber<uint16_t>(), count);
             break;
         case TP_LIST32:
-            ret = parseArray(node, readNumber<uint32_t>());
+            ret = parseArray(node, readNumber<uint32_t>(), count);
             break;
             
         case TP_DICT0:
             node.setDict(allocator_);
             break;
         case TP_DICT8:
-            ret = parseDict(node, readNumber<uint8_t>());
+            ret = parseDict(node, readNumber<uint8_t>(), count);
             break;
         case TP_DICT16:
-            ret = parseDict(node, readNumber<uint16_t>());
+            ret = parseDict(node, readNumber<uint16_t>(), count);
             break;
         case TP_DICT32:
-            ret = parseDict(node, readNumber<uint32_t>());
+            ret = parseDict(node, readNumber<uint32_t>(), count);
             break; 
             
         default:
-            return onError(RC_INVALID_TYPE);
+            onError(RC_INVALID_TYPE);
+            return 0;
     };
-    return ret;
+    return errorCode_ == RC_OK ? ret : 0;
 }
 
 bool BinaryParser::parseStringTable()
 {
     size_t size = 0;
-    size_t maxStringLength = 1024;
 
     if (version_ >= 2)
     {
         size = readNumber<uint32_t>();
-        maxStringLength = readNumber<uint32_t>();
+        readNumber<uint32_t>(); // max string length, useless for memory data.
     }
     else
     {
@@ -205,35 +287,37 @@ bool BinaryParser::parseStringTable()
         }
         size = node.as<uint32_t>();
     }
-    stringTable_.reserve(size);
 
-    std::vector<char> buffer;
-    buffer.reserve(maxStringLength);
+    // 每个字符串至少占用2个字节的长度
+    if (size > (size_t)(end_ - cursor_) / 2)
+    {
+        return onError(RC_INVALID_STRING);
+    }
+    stringTable_.reserve(size);
     
     for(size_t i = 0; i < size; ++i)
     {
         size_t length = readNumber<uint16_t>();
+        if(length > (size_t)(end_ - cursor_))
+        {
+            return onError(RC_INVALID_STRING);
+        }
         if(length == 0)
         {
             stringTable_.push_back(Node("", 0, allocator_));
         }
         else
         {
-            buffer.resize(length);
-            stream_->read(buffer.data(), length);
-            if(!stream_->good())
-            {
-                return onError(RC_INVALID_STRING);
-            }
-            stringTable_.push_back(Node(buffer.data(), length, allocator_));
+            stringTable_.push_back(Node(cursor_, length, allocator_));
+            cursor_ += length;
         }
     }
-    return true;
+    return errorCode_ == RC_OK;
 }
 
 bool BinaryParser::parseString(Node &node, size_t size)
 {
-    if(size > stringTable_.size())
+    if(size >= stringTable_.size())
     {
         return onError(RC_INVALID_STRING);
     }
@@ -241,37 +325,32 @@ bool BinaryParser::parseString(Node &node, size_t size)
     return true;
 }
 
-bool BinaryParser::parseArray(Node &node, size_t size)
+int BinaryParser::parseArray(Node &node, size_t size, size_t &count)
 {
-    Array* arr = node.setArray(allocator_);
-    arr->resize(size);
-    
-    for(size_t i = 0; i < size; ++i)
+    // 每个元素至少占用1个字节，避免错误的数据导致分配过大的内存
+    if (size > (size_t)(end_ - cursor_))
     {
-        if(!parseValue((*arr)[i]))
-        {
-            return false;
-        }
-    } 
-    return true;
+        onError(RC_INVALID_ARRAY);
+        return 0;
+    }
+
+    node.setArray(allocator_)->reserve(size);
+    count = size;
+    return size > 0 ? 2 : 1;
 }
 
-bool BinaryParser::parseDict(Node &node, size_t size)
+int BinaryParser::parseDict(Node &node, size_t size, size_t &count)
 {
-    Dict* dict = node.setDict(allocator_);
-    dict->reserve(size);
-    
-    Node key, val;
-    for(size_t i = 0; i < size; ++i)
+    if (size > (size_t)(end_ - cursor_) / 2)
     {
-        if(!parseValue(key) || !parseValue(val))
-        {
-            return false;
-        }
-        (*dict)[key] = val;
+        onError(RC_INVALID_DICT);
+        return 0;
     }
-    return true;
-}
+
+    node.setDict(allocator_)->reserve(size);
+    count = size;
+    return size > 0 ? 2 : 1;
+}
 
 //////////////////////////////////////////////////////////////////////
 // BinaryWriter
@@ -548,15 +627,15 @@ void BinaryWriter::writeStringPool()
     {
         const StringValue *str = v->str_;
         writeNumber((uint16_t)str->size());
-        stream_->write(str->data(), str->size());
+        sink_->write(str->data(), str->size());
     }
 }
 
-BinaryWriter::BinaryWriter()
-{
-    isBinaryFile_ = true;
-}
-
+BinaryWriter::BinaryWriter()
+{
+    isBinaryFile_ = true;
+}
+
 void BinaryWriter::onWrite(const Node &node)
 {
     StringPool stringPool;
@@ -575,7 +654,7 @@ void BinaryWriter::onWrite(const Node &node)
     writeNumber((uint16_t)reserveSize);
     for (size_t i = 0; i < reserveSize; ++i)
     {
-        stream_->write("\0", 1);
+        sink_->write("\0", 1);
     }
 
     writeNumber((uint32_t)strings.size());
@@ -585,7 +664,7 @@ void BinaryWriter::onWrite(const Node &node)
     {
         const StringValue *str = v->str_;
         writeNumber((uint16_t)str->size());
-        stream_->write(str->data(), str->size());
+        sink_->write(str->data(), str->size());
     }
 
     writeValue(node);
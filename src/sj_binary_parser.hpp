@@ -50,23 +50,44 @@ private:
     bool doParse() override;
 
     bool parseValue(Node &node);
+    int parseScalar(Node &node, size_t &count);
     bool parseStringTable();
     
     bool parseString(Node &node, size_t size);
-    bool parseArray(Node &node, size_t size);
-    bool parseDict(Node &node, size_t size);
+    int parseArray(Node &node, size_t size, size_t &count);
+    int parseDict(Node &node, size_t size, size_t &count);
 
     template <typename T>
     inline T readNumber()
     {
-        T ret;
-        stream_->read(reinterpret_cast<char*>(&ret), sizeof(ret));
+        T ret = T();
+        if (sizeof(ret) <= (size_t)(end_ - cursor_))
+        {
+            memcpy(&ret, cursor_, sizeof(ret));
+            cursor_ += sizeof(ret);
+        }
+        else
+        {
+            cursor_ = end_;
+            onError(RC_END_OF_FILE);
+        }
         return ret;
     }
 
+    /** parseValue使用的容器栈，保存还没有读取完的容器 */
+    struct Frame
+    {
+        Node        node;
+        Node        key;
+        /** 剩余的元素个数，字典的一个元素包含key和value */
+        size_t      remaining;
+        bool        hasKey;
+    };
+
     size_t          errorOffset_;
     Array           stringTable_;
     size_t          version_;
+    std::vector<Frame> frames_;
 };
 
 
@@ -94,7 +115,7 @@ private:
     template <typename T>
     inline void writeNumber(T value)
     {
-        stream_->write(reinterpret_cast<char*>(&value), sizeof(value));
+        sink_->write(reinterpret_cast<char*>(&value), sizeof(value));
     }
 
 private:
@@ -0,0 +1,344 @@
+﻿#pragma once
+#include "sj_reader.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  数据绑定：由JsonReader读取词法单元，直接写入到C++对象中，不会创建中间的节点。
+ *  结构体需要提供一个describe函数，描述它的字段，每个类型只会调用一次：
+ *
+ *  struct Item { int id; std::string name; std::vector<int> tags; };
+ *  void describe(Schema<Item> &schema)
+ *  {
+ *      schema.field("id", &Item::id);
+ *      schema.field("name", &Item::name);
+ *      schema.field("tags", &Item::tags);
+ *  }
+ *
+ *  JsonReader reader;
+ *  reader.openFile("items.json");
+ *  std::vector<Item> items;
+ *  if (!readJson(items, reader)) ... reader.getErrorCode()
+ *
+ *  支持bool、整数、浮点数、std::string、std::vector、key为字符串的std::unordered_map和std::map，
+ *  以及描述过的结构体，可以任意嵌套。其它类型可以特化JsonBinder。
+ *  json中多出的字段会被跳过；缺少的字段和值为null的字段保持原值。类型不匹配时，错误码为RC_INVALID_TYPE。
+ *  整数字段只接受没有小数部分、且在字段类型范围内的值，如uint8_t读取300也是类型不匹配。
+ */
+template <typename T, typename Enable = void>
+struct JsonBinder;
+
+/** 读取下一个完整的json文档到value中 */
+template <typename T>
+bool readJson(T &value, JsonReader &reader)
+{
+    reader.next();
+    if (!JsonBinder<T>::read(value, reader))
+    {
+        return false;
+    }
+    // 检查文档是否已经结束
+    return reader.next() == JsonReader::TK_END && reader.getErrorCode() == RC_OK;
+}
+
+/** 结构体的字段描述 */
+template <typename T>
+class Schema
+{
+    SJ_DISABLE_COPY_ASSIGN(Schema);
+public:
+    typedef std::function<bool(T &object, JsonReader &reader)> Reader;
+
+    struct Field
+    {
+        std::string key;
+        Reader      read;
+    };
+
+    template <typename M>
+    void field(const std::string &key, M T::*member)
+    {
+        Field f;
+        f.key = key;
+        f.read = [member](T &object, JsonReader &reader)
+        {
+            return JsonBinder<M>::read(object.*member, reader);
+        };
+        fields_.push_back(f);
+    }
+
+    /** 查找key对应的字段。字段通常按照声明的顺序出现，hint是下一次开始查找的位置 */
+    const Field* find(const char *key, size_t length, size_t &hint) const
+    {
+        for (size_t n = 0; n < fields_.size(); ++n)
+        {
+            size_t i = hint + n < fields_.size() ? hint + n : hint + n - fields_.size();
+            const Field &f = fields_[i];
+            if (f.key.size() == length && memcmp(f.key.data(), key, length) == 0)
+            {
+                hint = i + 1;
+                return &f;
+            }
+        }
+        return nullptr;
+    }
+
+    /** 由describe(Schema<T>&)创建，线程安全 */
+    static const Schema& instance()
+    {
+        static Schema schema(0);
+        return schema;
+    }
+
+private:
+    explicit Schema(int)
+    {
+        describe(*this);
+    }
+
+    std::vector<Field> fields_;
+};
+
+inline bool bindError(JsonReader &reader)
+{
+    reader.setError(RC_INVALID_TYPE);
+    return false;
+}
+
+/** 描述过的结构体 */
+template <typename T, typename Enable>
+struct JsonBinder
+{
+    static bool read(T &value, JsonReader &reader)
+    {
+        JsonReader::Token token = reader.getToken();
+        if (token == JsonReader::TK_NULL)
+        {
+            return true;
+        }
+        if (token != JsonReader::TK_START_DICT)
+        {
+            return bindError(reader);
+        }
+
+        const Schema<T> &schema = Schema<T>::instance();
+        size_t hint = 0;
+        while (true)
+        {
+            token = reader.next();
+            if (token == JsonReader::TK_END_DICT)
+            {
+                return true;
+            }
+            if (token != JsonReader::TK_KEY)
+            {
+                return false;
+            }
+
+            const typename Schema<T>::Field *field = schema.find(reader.getString(), reader.getLength(), hint);
+            if (field == nullptr)
+            {
+                if (!reader.skipValue())
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            reader.next();
+            if (!field->read(value, reader))
+            {
+                return false;
+            }
+        }
+    }
+};
+
+template <>
+struct JsonBinder<bool>
+{
+    static bool read(bool &value, JsonReader &reader)
+    {
+        switch (reader.getToken())
+        {
+        case JsonReader::TK_BOOL:
+            value = reader.getBool();
+            return true;
+        case JsonReader::TK_NULL:
+            return true;
+        default:
+            return bindError(reader);
+        }
+    }
+};
+
+template <typename T>
+struct JsonBinder<T, typename std::enable_if<std::is_integral<T>::value>::type>
+{
+    static bool read(T &value, JsonReader &reader)
+    {
+        switch (reader.getToken())
+        {
+        case JsonReader::TK_INT:
+        {
+            int64_t integer = reader.getInt64();
+            if (integer < 0 ?
+                !std::is_signed<T>::value || (intmax_t)integer < (intmax_t)std::numeric_limits<T>::min() :
+                (uintmax_t)integer > (uintmax_t)std::numeric_limits<T>::max())
+            {
+                return bindError(reader);
+            }
+            value = static_cast<T>(integer);
+            return true;
+        }
+        case JsonReader::TK_FLOAT:
+        {
+            // 只接受没有小数部分、且在T的范围内的值。T的范围是[-2^digits, 2^digits)或[0, 2^digits)
+            double real = reader.getFloat();
+            double limit = std::ldexp(1.0, std::numeric_limits<T>::digits);
+            if (real != std::floor(real) || real >= limit || real < (std::is_signed<T>::value ? -limit : 0.0))
+            {
+                return bindError(reader);
+            }
+            value = static_cast<T>(real);
+            return true;
+        }
+        case JsonReader::TK_NULL:
+            return true;
+        default:
+            return bindError(reader);
+        }
+    }
+};
+
+template <typename T>
+struct JsonBinder<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static bool read(T &value, JsonReader &reader)
+    {
+        switch (reader.getToken())
+        {
+        case JsonReader::TK_INT:
+        case JsonReader::TK_FLOAT:
+            value = static_cast<T>(reader.getFloat());
+            return true;
+        case JsonReader::TK_NULL:
+            return true;
+        default:
+            return bindError(reader);
+        }
+    }
+};
+
+template <>
+struct JsonBinder<std::string>
+{
+    static bool read(std::string &value, JsonReader &reader)
+    {
+        switch (reader.getToken())
+        {
+        case JsonReader::TK_STRING:
+            value.assign(reader.getString(), reader.getLength());
+            return true;
+        case JsonReader::TK_NULL:
+            return true;
+        default:
+            return bindError(reader);
+        }
+    }
+};
+
+template <typename T, typename A>
+struct JsonBinder<std::vector<T, A>>
+{
+    static bool read(std::vector<T, A> &value, JsonReader &reader)
+    {
+        JsonReader::Token token = reader.getToken();
+        if (token == JsonReader::TK_NULL)
+        {
+            return true;
+        }
+        if (token != JsonReader::TK_START_ARRAY)
+        {
+            return bindError(reader);
+        }
+
+        value.clear();
+        while (reader.next() != JsonReader::TK_END_ARRAY)
+        {
+            // 使用临时变量，兼容std::vector<bool>
+            T item = T();
+            if (!JsonBinder<T>::read(item, reader))
+            {
+                return false;
+            }
+            value.push_back(std::move(item));
+        }
+        return true;
+    }
+};
+
+/** key为字符串的字典 */
+template <typename Map>
+struct JsonMapBinder
+{
+    static bool read(Map &value, JsonReader &reader)
+    {
+        JsonReader::Token token = reader.getToken();
+        if (token == JsonReader::TK_NULL)
+        {
+            return true;
+        }
+        if (token != JsonReader::TK_START_DICT)
+        {
+            return bindError(reader);
+        }
+
+        value.clear();
+        while (true)
+        {
+            token = reader.next();
+            if (token == JsonReader::TK_END_DICT)
+            {
+                return true;
+            }
+            if (token != JsonReader::TK_KEY)
+            {
+                return false;
+            }
+
+            // 整数key使用它的原始文本
+            typename Map::mapped_type &item = value[std::string(reader.getString(), reader.getLength())];
+            reader.next();
+            if (!JsonBinder<typename Map::mapped_type>::read(item, reader))
+            {
+                return false;
+            }
+        }
+    }
+};
+
+template <typename T, typename H, typename E, typename A>
+struct JsonBinder<std::unordered_map<std::string, T, H, E, A>>
+    : JsonMapBinder<std::unordered_map<std::string, T, H, E, A>>
+{
+};
+
+template <typename T, typename C, typename A>
+struct JsonBinder<std::map<std::string, T, C, A>>
+    : JsonMapBinder<std::map<std::string, T, C, A>>
+{
+};
+
+NS_SMARTJSON_END
@@ -4,6 +4,20 @@
 #define SJ_USE_LARGE_NUMBER 1
 #endif
 
+/** 使用内存映射的方式加载文件 */
+#ifndef SJ_USE_MMAP
+#   if defined(_WIN32) || defined(__unix__) || defined(__APPLE__)
+#       define SJ_USE_MMAP 1
+#   else
+#       define SJ_USE_MMAP 0
+#   endif
+#endif
+
+/** 运行时检测CPU支持的指令集，选择对应的SIMD函数。关闭时只使用编译选项开启的指令集 */
+#ifndef SJ_USE_CPU_DISPATCH
+#define SJ_USE_CPU_DISPATCH 1
+#endif
+
 #if defined(__LP64__) || defined(_WIN64) || (defined(__x86_64__) && !defined(__ILP32__) ) || defined(_M_X64) || defined(__ia64) || defined (_M_IA64) || defined(__aarch64__) || defined(__powerpc64__)
 #define SJ_PLATFORM_64BIT 1
 #else
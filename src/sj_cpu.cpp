@@ -0,0 +1,137 @@
+﻿#include "sj_simd.hpp"
+
+#if SJ_SIMD_X86 && !defined(_MSC_VER)
+#   include <cpuid.h>
+#endif
+
+NS_SMARTJSON_BEGIN
+
+namespace
+{
+#if SJ_SIMD_X86
+
+    void cpuid(unsigned regs[4], unsigned leaf, unsigned subleaf)
+    {
+#ifdef _MSC_VER
+        __cpuidex(reinterpret_cast<int*>(regs), (int)leaf, (int)subleaf);
+#else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    /** 操作系统在线程切换时保存了哪些寄存器 */
+    uint64_t xgetbv()
+    {
+#ifdef _MSC_VER
+        return _xgetbv(0);
+#else
+        uint32_t eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return eax | ((uint64_t)edx << 32);
+#endif
+    }
+
+    unsigned detectCpuFeatures()
+    {
+        unsigned regs[4];
+        cpuid(regs, 0, 0);
+        unsigned maxLeaf = regs[0];
+
+        cpuid(regs, 1, 0);
+        unsigned ecx = regs[2], edx = regs[3];
+
+        unsigned features = 0;
+        if (edx & (1u << 26))
+        {
+            features |= CPU_SSE2;
+        }
+        if (ecx & (1u << 20))
+        {
+            features |= CPU_SSE42;
+        }
+
+        // AVX指令还需要操作系统支持保存YMM/ZMM寄存器
+        bool osxsave = (ecx & (1u << 27)) != 0 && (ecx & (1u << 28)) != 0;
+        if (!osxsave || maxLeaf < 7)
+        {
+            return features;
+        }
+
+        uint64_t xcr0 = xgetbv();
+        bool ymm = (xcr0 & 0x06) == 0x06;
+        bool zmm = (xcr0 & 0xe6) == 0xe6;
+
+        cpuid(regs, 7, 0);
+        unsigned ebx = regs[1];
+        if (ymm && (ebx & (1u << 5)))
+        {
+            features |= CPU_AVX2;
+        }
+        if (zmm && (ebx & (1u << 16)) && (ebx & (1u << 30)))
+        {
+            features |= CPU_AVX512;
+        }
+        return features;
+    }
+
+#else
+
+    unsigned detectCpuFeatures()
+    {
+#if SJ_SIMD_NEON
+        return CPU_NEON;
+#else
+        return 0;
+#endif
+    }
+
+#endif
+
+    SimdKernels s_kernels;
+    /** 静态初始化之前也可能被调用，依赖零初始化 */
+    bool s_bound = false;
+
+    void bindDefaultKernels()
+    {
+        if (!s_bound)
+        {
+            setSimdFeatures(getCpuFeatures());
+        }
+    }
+
+    // 程序启动时选择SIMD函数，之后不再检测
+    const bool s_initialized = (bindDefaultKernels(), true);
+}
+
+unsigned getCpuFeatures()
+{
+    static const unsigned features = detectCpuFeatures();
+    return features;
+}
+
+unsigned getSimdFeatures()
+{
+    return getSimdKernels().features;
+}
+
+void setSimdFeatures(unsigned features)
+{
+    features &= getCpuFeatures();
+
+    SimdKernels kernels;
+    kernels.features = features;
+    bindStringScanKernels(kernels, features);
+    bindUTF8Kernels(kernels, features);
+    bindStructuralIndexKernels(kernels, features);
+
+    s_kernels = kernels;
+    s_bound = true;
+}
+
+const SimdKernels& getSimdKernels()
+{
+    bindDefaultKernels();
+    return s_kernels;
+}
+
+NS_SMARTJSON_END
@@ -0,0 +1,32 @@
+﻿#pragma once
+#include "sj_config.hpp"
+
+NS_SMARTJSON_BEGIN
+
+/** SIMD指令集 */
+enum CpuFeature
+{
+    CPU_SSE2    = 1 << 0,
+    CPU_SSE42   = 1 << 1,
+    CPU_AVX2    = 1 << 2,
+    /** AVX-512F和AVX-512BW */
+    CPU_AVX512  = 1 << 3,
+    CPU_NEON    = 1 << 4,
+
+    CPU_ALL     = 0xff,
+};
+
+/** 当前CPU和操作系统支持的指令集。只在第一次调用时检测 */
+unsigned getCpuFeatures();
+
+/** SIMD函数实际使用的指令集 */
+unsigned getSimdFeatures();
+
+/**
+ *  只使用features中的指令集，重新选择字符串扫描、转义、UTF-8检查和结构索引使用的SIMD函数。
+ *  不支持的指令集会被忽略；传入0强制使用标量实现，用于测试。
+ *  程序启动时会自动按getCpuFeatures()选择。该函数不是线程安全的，需要在解析之前调用。
+ */
+void setSimdFeatures(unsigned features);
+
+NS_SMARTJSON_END
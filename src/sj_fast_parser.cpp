@@ -0,0 +1,358 @@
+﻿#include "sj_fast_parser.hpp"
+#include "sj_source_buffer.hpp"
+#include "sj_utils.hpp"
+#include "sj_number.hpp"
+
+NS_SMARTJSON_BEGIN
+
+static const char s_endToken[1] = { 0 };
+
+FastParser::FastParser(IAllocator *allocator)
+    : IParser(allocator)
+{
+}
+
+inline const char* FastParser::nextToken()
+{
+    if (position_ < index_.size())
+    {
+        return begin_ + index_[position_++];
+    }
+    return s_endToken;
+}
+
+inline char FastParser::aheadToken() const
+{
+    if (position_ < index_.size())
+    {
+        return begin_[index_[position_]];
+    }
+    return 0;
+}
+
+inline size_t FastParser::nextElementCount()
+{
+    return containerIndex_ < elementCounts_.size() ? elementCounts_[containerIndex_++] : 0;
+}
+
+/** 容器的元素个数等于同一层的','个数加1，空容器的起始符后面紧跟着结束符 */
+void FastParser::countElements()
+{
+    std::vector<size_t> stack;
+    const size_t n = index_.size();
+    for (size_t i = 0; i < n; ++i)
+    {
+        char ch = begin_[index_[i]];
+        switch (ch)
+        {
+        case '{':
+        case '[':
+        {
+            char next = i + 1 < n ? begin_[index_[i + 1]] : 0;
+            stack.push_back(elementCounts_.size());
+            elementCounts_.push_back(next == '}' || next == ']' ? 0 : 1);
+            break;
+        }
+
+        case '}':
+        case ']':
+            if (!stack.empty())
+            {
+                stack.pop_back();
+            }
+            break;
+
+        case ',':
+            if (!stack.empty())
+            {
+                ++elementCounts_[stack.back()];
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+bool FastParser::doParse()
+{
+    position_ = 0;
+    errorOffset_ = 0;
+
+    if (!index_.build(begin_, end_ - begin_))
+    {
+        errorOffset_ = end_ - begin_;
+        return onError(RC_INVALID_STRING);
+    }
+
+    elementCounts_.clear();
+    containerIndex_ = 0;
+    if (presize_)
+    {
+        countElements();
+    }
+
+    if (parseValue(root_) && position_ != index_.size())
+    {
+        // 末尾有多余的符号
+        onError(RC_INVALID_JSON);
+    }
+
+    if (errorCode_ != RC_OK)
+    {
+        errorOffset_ = position_ > 0 ? index_[position_ - 1] : 0;
+    }
+
+    // 出错时释放未完成的容器
+    frames_.clear();
+    index_.clear();
+    return errorCode_ == RC_OK;
+}
+
+/** 非递归地解析一个值。未完成的容器保存在frames_中，而不是函数调用栈上，嵌套深度受maxDepth_限制 */
+bool FastParser::parseValue(Node &node)
+{
+    frames_.clear();
+    Node value;
+    while (true)
+    {
+        const char *p = nextToken();
+        if (*p == '{' || *p == '[')
+        {
+            if (frames_.size() >= maxDepth_)
+            {
+                return onError(RC_TOO_DEEP);
+            }
+
+            frames_.emplace_back();
+            Frame &frame = frames_.back();
+            frame.isDict = *p == '{';
+            size_t count = nextElementCount();
+            if (frame.isDict)
+            {
+                Dict *dict = frame.node.setDict(allocator_);
+                if (count > 0)
+                {
+                    dict->reserve(count);
+                }
+            }
+            else
+            {
+                Array *array = frame.node.setArray(allocator_);
+                if (count > 0)
+                {
+                    array->reserve(count);
+                }
+            }
+
+            if (aheadToken() != (frame.isDict ? '}' : ']'))
+            {
+                if (frame.isDict && !parseKey(frame.key))
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            // 空容器
+            nextToken();
+            value = std::move(frame.node);
+            frames_.pop_back();
+        }
+        else if (!parseScalar(value, p))
+        {
+            return false;
+        }
+
+        // value已经完成，加入所在的容器。容器结束时，它自己又是上一层容器中完成的值
+        while (true)
+        {
+            if (frames_.empty())
+            {
+                node = std::move(value);
+                return true;
+            }
+
+            Frame &frame = frames_.back();
+            if (frame.isDict)
+            {
+                frame.node.emplaceMember(std::move(frame.key), std::move(value));
+            }
+            else
+            {
+                frame.node.refArray().push_back(std::move(value));
+            }
+
+            char ch = *nextToken();
+            if (ch == ',')
+            {
+                if (frame.isDict && !parseKey(frame.key))
+                {
+                    return false;
+                }
+                break;
+            }
+            if (ch != (frame.isDict ? '}' : ']'))
+            {
+                return onError(frame.isDict ? RC_INVALID_DICT : RC_INVALID_ARRAY);
+            }
+
+            value = std::move(frame.node);
+            frames_.pop_back();
+        }
+    }
+}
+
+/** 解析字典的key和后面的':' */
+bool FastParser::parseKey(Node &key)
+{
+    const char *p = nextToken();
+    if (*p != '"')
+    {
+        return onError(RC_INVALID_KEY);
+    }
+
+    if (!parseString(key, p + 1))
+    {
+        return false;
+    }
+
+    if (*nextToken() != ':')
+    {
+        return onError(RC_INVALID_DICT);
+    }
+    return true;
+}
+
+bool FastParser::parseScalar(Node &node, const char *p)
+{
+    switch (*p)
+    {
+    case '\0':
+        return onError(RC_END_OF_FILE);
+
+    case '"':
+        return parseString(node, p + 1);
+
+    case 't':
+        if (!parseLiteral(p, "true", 4))
+        {
+            return onError(RC_INVALID_TRUE);
+        }
+        node = true;
+        return true;
+
+    case 'f':
+        if (!parseLiteral(p, "false", 5))
+        {
+            return onError(RC_INVALID_FALSE);
+        }
+        node = false;
+        return true;
+
+    case 'n':
+        if (!parseLiteral(p, "null", 4))
+        {
+            return onError(RC_INVALID_NULL);
+        }
+        node.setNull();
+        return true;
+
+    default:
+        return parseNumber(node, p);
+    }
+}
+
+bool FastParser::parseString(Node &node, const char *p)
+{
+    // 第一阶段已经保证了字符串是闭合的
+    const char *begin = p;
+    bool hasEscape = false;
+    while (true)
+    {
+        char ch = *p;
+        if (ch == '"')
+        {
+            break;
+        }
+        else if (ch == '\\')
+        {
+            // 与StrictParser相同，只接受json标准定义的转义字符
+            if (p[1] != 'u' && !isEscapeChar(p[1]))
+            {
+                return onError(RC_INVALID_CHAR);
+            }
+            hasEscape = true;
+            p += 2;
+        }
+        else if (ch == '\n')
+        {
+            return onError(RC_INVALID_STRING);
+        }
+        else
+        {
+            ++p;
+        }
+    }
+
+    if (p == begin)
+    {
+        node = allocator_->createString(nullptr, 0, BT_NOT_CARE);
+        return true;
+    }
+
+    if (source_ != nullptr)
+    {
+        // 原地解析，输入数据来自可写的source_
+        char *dest = const_cast<char*>(begin);
+        char *destEnd = const_cast<char*>(p);
+        if (hasEscape)
+        {
+            destEnd = decodeString(begin, p, dest, false);
+            if (destEnd == nullptr)
+            {
+                return onError(RC_INVALID_UNICODE);
+            }
+        }
+        *destEnd = '\0';
+        node = allocator_->createSharedString(dest, destEnd - dest, source_);
+        return true;
+    }
+
+    if (!hasEscape)
+    {
+        node = allocator_->createString(begin, p - begin, BT_MAKE_COPY);
+        return true;
+    }
+
+    stringBuffer_.resize(p - begin);
+    char *destEnd = decodeString(begin, p, stringBuffer_.data(), false);
+    if (destEnd == nullptr)
+    {
+        return onError(RC_INVALID_UNICODE);
+    }
+    node = allocator_->createString(stringBuffer_.data(), destEnd - stringBuffer_.data(), BT_MAKE_COPY);
+    return true;
+}
+
+bool FastParser::parseLiteral(const char *p, const char *literal, size_t length)
+{
+    return (size_t)(end_ - p) >= length &&
+        memcmp(p, literal, length) == 0 &&
+        (p + length == end_ || isDelimiter(p[length]));
+}
+
+bool FastParser::parseNumber(Node &node, const char *p)
+{
+    NumberResult result;
+    p = smartjson::parseNumber(p, end_, result);
+    if (p == nullptr || (p != end_ && !isDelimiter(*p)))
+    {
+        return onError(RC_INVALID_NUMBER);
+    }
+    setNumber(node, result);
+    return true;
+}
+
+NS_SMARTJSON_END
@@ -0,0 +1,57 @@
+﻿#pragma once
+#include "sj_parser.hpp"
+#include "sj_structural_index.hpp"
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  两阶段的高吞吐量json解析器。
+ *  第一阶段使用StructuralIndex批量找出所有结构字符的位置，第二阶段遍历索引构造Node树，
+ *  不再逐个字符地判断token。
+ *  只支持标准的json格式(RFC 8259)：不支持注释、十六进制等扩展的数字格式、'\x'转义符和数组字典尾部的逗号，
+ *  字典的key必须是字符串。适合解析由程序生成的大文件。
+ */
+class FastParser : public IParser
+{
+    SJ_DISABLE_COPY_ASSIGN(FastParser);
+public:
+    explicit FastParser(IAllocator *allocator = nullptr);
+
+    size_t getErrorOffset() const { return errorOffset_; }
+
+private:
+    bool doParse() override;
+
+    /** 返回下一个结构字符的位置。索引用完后，返回指向'\0'的指针 */
+    inline const char* nextToken();
+    inline char aheadToken() const;
+
+    bool parseValue(Node &node);
+    bool parseKey(Node &key);
+    bool parseScalar(Node &node, const char *p);
+    bool parseString(Node &node, const char *p);
+    bool parseNumber(Node &node, const char *p);
+    bool parseLiteral(const char *p, const char *literal, size_t length);
+
+    /** presize_时根据索引统计每个容器的元素个数 */
+    void countElements();
+    inline size_t nextElementCount();
+
+    StructuralIndex index_;
+    size_t          position_ = 0;
+    size_t          errorOffset_ = 0;
+    /** parseValue使用的容器栈，解析结束后保留内存，供下一次使用 */
+    struct Frame
+    {
+        Node        node;
+        /** 字典中正在解析的元素的key */
+        Node        key;
+        bool        isDict = false;
+    };
+    std::vector<Frame> frames_;
+    std::vector<size_t> elementCounts_;
+    size_t          containerIndex_ = 0;
+    std::vector<char> stringBuffer_;
+};
+
+NS_SMARTJSON_END
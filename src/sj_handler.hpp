@@ -0,0 +1,35 @@
+﻿#pragma once
+#include "sj_node.hpp"
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  SAX风格的事件处理器。
+ *  Parser设置了handler后，解析时不会创建任何节点，而是按照文档顺序回调以下接口。
+ *  默认实现什么也不做，只需要重写关心的接口。任何接口返回false都会终止解析，
+ *  此时错误码为RC_HANDLER_ABORTED。
+ *  字符串参数只在回调期间有效，并且不保证以'\0'结尾。
+ */
+class IHandler
+{
+public:
+    virtual ~IHandler() = default;
+
+    virtual bool onNull() { return true; }
+    virtual bool onBool(bool /*value*/) { return true; }
+    virtual bool onInt(Integer /*value*/) { return true; }
+    virtual bool onFloat(double /*value*/) { return true; }
+    virtual bool onString(const char * /*str*/, size_t /*length*/) { return true; }
+
+    virtual bool onStartDict() { return true; }
+    /** 字典的key。key是整数时，回调的是onInt */
+    virtual bool onKey(const char * /*str*/, size_t /*length*/) { return true; }
+    /** memberCount是字典的元素个数 */
+    virtual bool onEndDict(size_t /*memberCount*/) { return true; }
+
+    virtual bool onStartArray() { return true; }
+    /** elementCount是数组的元素个数 */
+    virtual bool onEndArray(size_t /*elementCount*/) { return true; }
+};
+
+NS_SMARTJSON_END
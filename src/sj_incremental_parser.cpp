@@ -0,0 +1,499 @@
+﻿#include "sj_incremental_parser.hpp"
+#include "sj_utils.hpp"
+
+#include <cstring>
+
+NS_SMARTJSON_BEGIN
+
+/** 数字和true、false、null可能包含的字符 */
+static inline bool isTokenChar(char ch)
+{
+    return (ch >= '0' && ch <= '9') ||
+        (ch >= 'a' && ch <= 'z') ||
+        (ch >= 'A' && ch <= 'Z') ||
+        ch == '.' || ch == '+' || ch == '-';
+}
+
+IncrementalParser::IncrementalParser(IAllocator *allocator)
+    : IParser(allocator)
+{
+}
+
+void IncrementalParser::reset()
+{
+    root_.setNull();
+    errorCode_ = RC_OK;
+    stack_.clear();
+    state_ = S_ROOT;
+    lexer_ = L_NONE;
+    token_.clear();
+    offset_ = 0;
+}
+
+bool IncrementalParser::doParse()
+{
+    reset();
+    feed(begin_, end_ - begin_);
+    return finish();
+}
+
+bool IncrementalParser::feed(const char *data, size_t length)
+{
+    if (errorCode_ != RC_OK)
+    {
+        return false;
+    }
+
+    const char *p = data;
+    const char *end = data + length;
+    while (p != end && errorCode_ == RC_OK)
+    {
+        // 继续上一次被切断的词法单元
+        if (lexer_ != L_NONE)
+        {
+            p = feedToken(p, end);
+            continue;
+        }
+
+        char ch = *p;
+        switch (ch)
+        {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+            ++p;
+            break;
+
+        case '{':
+        case '[':
+            if (onOpen(ch == '{'))
+            {
+                ++p;
+            }
+            break;
+
+        case '}':
+        case ']':
+            if (onClose(ch == '}'))
+            {
+                ++p;
+            }
+            break;
+
+        case ',':
+        case ':':
+            if (onSeparator(ch))
+            {
+                ++p;
+            }
+            break;
+
+        case '"':
+            lexer_ = L_STRING;
+            ++p;
+            break;
+
+        case '/':
+            if (onComment())
+            {
+                lexer_ = L_SLASH;
+                ++p;
+            }
+            break;
+
+        default:
+            if ((ch >= '0' && ch <= '9') || ch == '-' || ch == '+' || ch == '.')
+            {
+                lexer_ = L_NUMBER;
+            }
+            else if (ch >= 'a' && ch <= 'z')
+            {
+                lexer_ = L_LITERAL;
+            }
+            else
+            {
+                onError(stateError());
+            }
+            break;
+        }
+    }
+
+    // 出错时，p指向出错的位置
+    offset_ += p - data;
+    return errorCode_ == RC_OK;
+}
+
+/** 继续读取词法单元，返回读取结束的位置 */
+const char* IncrementalParser::feedToken(const char *p, const char *end)
+{
+    const char *begin = p;
+    switch (lexer_)
+    {
+    case L_STRING:
+    case L_STRING_ESCAPE:
+        if (lexer_ == L_STRING_ESCAPE)
+        {
+            // 上一段数据以'\'结尾
+            ++p;
+            lexer_ = L_STRING;
+        }
+        while (p != end && *p != '"')
+        {
+            char ch = *p++;
+            if (ch == '\\')
+            {
+                if (p == end)
+                {
+                    lexer_ = L_STRING_ESCAPE;
+                    break;
+                }
+                ++p;
+            }
+            else if (ch == '\n' || ch == '\0')
+            {
+                onError(RC_INVALID_STRING);
+                return p;
+            }
+        }
+        if (p == end)
+        {
+            token_.append(begin, p);
+            return p;
+        }
+        finishToken(begin, p);
+        return p + 1;
+
+    case L_NUMBER:
+    case L_LITERAL:
+        while (p != end && isTokenChar(*p))
+        {
+            ++p;
+        }
+        if (p == end)
+        {
+            token_.append(begin, p);
+            return p;
+        }
+        {
+            Lexer lexer = lexer_;
+            // 与Parser相同，数字和字面量后面只能是空白或结构字符
+            if (finishToken(begin, p) && !isDelimiter(*p))
+            {
+                onError(lexer == L_NUMBER ? RC_INVALID_NUMBER :
+                    (stack_.back().isDict ? RC_INVALID_DICT : RC_INVALID_ARRAY));
+            }
+        }
+        return p;
+
+    case L_SLASH:
+        if (*p == '/')
+        {
+            lexer_ = L_LINE_COMMENT;
+        }
+        else if (*p == '*')
+        {
+            lexer_ = L_BLOCK_COMMENT;
+        }
+        else
+        {
+            onError(RC_INVALID_COMMENT);
+        }
+        return p + 1;
+
+    case L_LINE_COMMENT:
+        p = (const char*)memchr(p, '\n', end - p);
+        if (p == nullptr)
+        {
+            return end;
+        }
+        lexer_ = L_NONE;
+        return p + 1;
+
+    case L_BLOCK_COMMENT:
+        p = (const char*)memchr(p, '*', end - p);
+        if (p == nullptr)
+        {
+            return end;
+        }
+        lexer_ = L_BLOCK_COMMENT_STAR;
+        return p + 1;
+
+    case L_BLOCK_COMMENT_STAR:
+        if (*p == '/')
+        {
+            lexer_ = L_NONE;
+        }
+        else if (*p != '*')
+        {
+            lexer_ = L_BLOCK_COMMENT;
+        }
+        return p + 1;
+
+    default:
+        return p;
+    }
+}
+
+/** 词法单元读取完毕，[begin, end)是最后一段数据，之前的部分保存在token_中 */
+bool IncrementalParser::finishToken(const char *begin, const char *end)
+{
+    Lexer lexer = lexer_;
+    lexer_ = L_NONE;
+    if (!token_.empty())
+    {
+        token_.append(begin, end);
+        begin = token_.data();
+        end = begin + token_.size();
+    }
+
+    Node value;
+    int error = RC_OK;
+    bool extra = false;
+    if (lexer == L_STRING)
+    {
+        stringBuffer_.resize(end - begin + 1);
+        char *destEnd = decodeString(begin, end, stringBuffer_.data(), true, &error);
+        if (destEnd != nullptr)
+        {
+            value = allocator_->createString(stringBuffer_.data(), destEnd - stringBuffer_.data(), BT_MAKE_COPY);
+        }
+    }
+    else if (lexer == L_NUMBER)
+    {
+        NumberResult result;
+        if (parseExtendedNumber(begin, end, result) != end)
+        {
+            error = RC_INVALID_NUMBER;
+        }
+        else
+        {
+            setNumber(value, result);
+        }
+    }
+    else
+    {
+        // 与Parser相同，只匹配字面量本身，后面多余的字符由容器报错
+        size_t length = end - begin;
+        if (length >= 4 && memcmp(begin, "true", 4) == 0)
+        {
+            value = true;
+            extra = length > 4;
+        }
+        else if (length >= 5 && memcmp(begin, "false", 5) == 0)
+        {
+            value = false;
+            extra = length > 5;
+        }
+        else if (length >= 4 && memcmp(begin, "null", 4) == 0)
+        {
+            value.setNull();
+            extra = length > 4;
+        }
+        else
+        {
+            error = *begin == 't' ? RC_INVALID_TRUE :
+                (*begin == 'f' ? RC_INVALID_FALSE :
+                (*begin == 'n' ? RC_INVALID_NULL : stateError()));
+        }
+    }
+
+    token_.clear();
+    if (error != RC_OK)
+    {
+        return onError(error);
+    }
+    if (!onValue(value))
+    {
+        return false;
+    }
+    if (extra)
+    {
+        return onError(stack_.back().isDict ? RC_INVALID_DICT : RC_INVALID_ARRAY);
+    }
+    return true;
+}
+
+bool IncrementalParser::finish()
+{
+    if (errorCode_ != RC_OK)
+    {
+        return false;
+    }
+
+    switch (lexer_)
+    {
+    case L_NONE:
+    case L_LINE_COMMENT:
+        break;
+    case L_NUMBER:
+    case L_LITERAL:
+        finishToken(nullptr, nullptr);
+        break;
+    case L_STRING:
+    case L_STRING_ESCAPE:
+        onError(RC_INVALID_STRING);
+        break;
+    default:
+        onError(RC_INVALID_COMMENT);
+        break;
+    }
+    lexer_ = L_NONE;
+
+    if (errorCode_ == RC_OK && state_ != S_DONE)
+    {
+        onError(state_ == S_ROOT ? RC_INVALID_JSON : RC_END_OF_FILE);
+    }
+    return errorCode_ == RC_OK;
+}
+
+bool IncrementalParser::onValue(const Node &value)
+{
+    if (stack_.empty())
+    {
+        // 根节点只能是字典或数组
+        return onError(RC_INVALID_JSON);
+    }
+
+    Frame &frame = stack_.back();
+    if (frame.isDict)
+    {
+        if (state_ == S_FIRST || state_ == S_KEY)
+        {
+            if (!value.isString() && !value.isInt())
+            {
+                return onError(RC_INVALID_KEY);
+            }
+            frame.key = value;
+            state_ = S_COLON;
+            return true;
+        }
+        if (state_ != S_MEMBER)
+        {
+            return onError(stateError());
+        }
+        frame.container.emplaceMember(std::move(frame.key), Node(value));
+    }
+    else
+    {
+        if (state_ != S_FIRST && state_ != S_ELEMENT)
+        {
+            return onError(stateError());
+        }
+        frame.container.pushBack(value);
+    }
+
+    state_ = S_AFTER_VALUE;
+    return true;
+}
+
+bool IncrementalParser::onOpen(bool isDict)
+{
+    if (stack_.size() >= maxDepth_)
+    {
+        return onError(RC_TOO_DEEP);
+    }
+
+    Node container;
+    if (isDict)
+    {
+        container.setDict(allocator_);
+    }
+    else
+    {
+        container.setArray(allocator_);
+    }
+
+    // 容器先加入父节点，后续的元素直接添加到容器中
+    if (state_ == S_ROOT)
+    {
+        root_ = container;
+    }
+    else if (!onValue(container))
+    {
+        return false;
+    }
+
+    Frame frame;
+    frame.container = container;
+    frame.isDict = isDict;
+    stack_.push_back(frame);
+    state_ = S_FIRST;
+    return true;
+}
+
+bool IncrementalParser::onClose(bool isDict)
+{
+    if (stack_.empty() || (state_ != S_FIRST && state_ != S_AFTER_VALUE))
+    {
+        return onError(stateError());
+    }
+    if (stack_.back().isDict != isDict)
+    {
+        // 与Parser相同，报告的是当前容器的错误
+        return onError(isDict ? RC_INVALID_ARRAY : RC_INVALID_DICT);
+    }
+
+    stack_.pop_back();
+    state_ = stack_.empty() ? S_DONE : S_AFTER_VALUE;
+    return true;
+}
+
+/** 与Parser相同，注释只能出现在容器中需要key或值的位置 */
+bool IncrementalParser::onComment()
+{
+    switch (state_)
+    {
+    case S_FIRST:
+        // 注释后面必须是一个元素，不能直接结束容器
+        state_ = stack_.back().isDict ? S_KEY : S_ELEMENT;
+        return true;
+    case S_KEY:
+    case S_MEMBER:
+    case S_ELEMENT:
+        return true;
+    default:
+        return onError(stateError());
+    }
+}
+
+/** 当前状态下遇到无法识别的字符时的错误码，与Parser报告的相同 */
+int IncrementalParser::stateError() const
+{
+    switch (state_)
+    {
+    case S_ROOT:
+    case S_DONE:
+        return RC_INVALID_JSON;
+    case S_COLON:
+        return RC_INVALID_DICT;
+    case S_AFTER_VALUE:
+        return stack_.back().isDict ? RC_INVALID_DICT : RC_INVALID_ARRAY;
+    default:
+        // 需要key或值的位置，Parser会尝试按数字解析
+        return RC_INVALID_NUMBER;
+    }
+}
+
+bool IncrementalParser::onSeparator(char ch)
+{
+    if (ch == ',')
+    {
+        if (state_ != S_AFTER_VALUE)
+        {
+            return onError(stateError());
+        }
+        state_ = stack_.back().isDict ? S_KEY : S_ELEMENT;
+    }
+    else
+    {
+        if (state_ != S_COLON)
+        {
+            return onError(stateError());
+        }
+        state_ = S_MEMBER;
+    }
+    return true;
+}
+
+NS_SMARTJSON_END
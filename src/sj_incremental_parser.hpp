@@ -0,0 +1,106 @@
+﻿#pragma once
+#include "sj_parser.hpp"
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  可恢复的增量解析器。
+ *  数据可以在任意位置切分成多段，依次调用feed()输入，最后调用finish()结束。
+ *  字符串、数字、转义符和注释被切断时，解析状态会保留到下一次feed()。
+ *  只有跨越多段的词法单元才会被缓存，已经完成的部分直接构造到Node树中。
+ *  语法和错误码与Parser相同：支持注释和扩展的数字格式，注释只能出现在容器中需要key或值的位置，
+ *  数字和字面量后面只能是空白或结构字符。
+ *
+ *  用法:
+ *  IncrementalParser parser;
+ *  while (recv(socket, buffer, size))
+ *  {
+ *      if (!parser.feed(buffer, size)) break;
+ *  }
+ *  if (parser.finish()) use(parser.getRoot());
+ */
+class IncrementalParser : public IParser
+{
+    SJ_DISABLE_COPY_ASSIGN(IncrementalParser);
+public:
+    explicit IncrementalParser(IAllocator *allocator = nullptr);
+
+    /** 清除之前的状态，准备解析新的文档 */
+    void reset();
+
+    /** 输入下一段数据。出错时返回false，之后的输入都会被忽略 */
+    bool feed(const char *data, size_t length);
+
+    /** 输入结束。文档完整并且正确时返回true */
+    bool finish();
+
+    /** 到目前为止输入的字节数。出错时，是出错的位置 */
+    size_t getOffset() const { return offset_; }
+
+protected:
+    bool doParse() override;
+
+private:
+    /** 语法状态 */
+    enum State
+    {
+        /** 等待根节点 */
+        S_ROOT,
+        /** 刚读取了'{'或'['，容器可能为空 */
+        S_FIRST,
+        /** 等待字典的key */
+        S_KEY,
+        /** 读取了key，等待':' */
+        S_COLON,
+        /** 读取了':'，等待字典的值 */
+        S_MEMBER,
+        /** 等待数组的元素 */
+        S_ELEMENT,
+        /** 读取了一个值，等待','或容器结束符 */
+        S_AFTER_VALUE,
+        /** 根节点读取完毕 */
+        S_DONE,
+    };
+
+    /** 词法状态，记录被切断的词法单元 */
+    enum Lexer
+    {
+        L_NONE,
+        L_STRING,
+        L_STRING_ESCAPE,
+        L_NUMBER,
+        L_LITERAL,
+        /** 读取了'/' */
+        L_SLASH,
+        L_LINE_COMMENT,
+        L_BLOCK_COMMENT,
+        /** 块注释中读取了'*' */
+        L_BLOCK_COMMENT_STAR,
+    };
+
+    struct Frame
+    {
+        Node        container;
+        Node        key;
+        bool        isDict;
+    };
+
+    const char* feedToken(const char *p, const char *end);
+    bool finishToken(const char *begin, const char *end);
+    bool onValue(const Node &value);
+    bool onOpen(bool isDict);
+    bool onClose(bool isDict);
+    bool onSeparator(char ch);
+    bool onComment();
+    int stateError() const;
+
+    std::vector<Frame> stack_;
+    State           state_ = S_ROOT;
+    Lexer           lexer_ = L_NONE;
+    /** 被切断的词法单元 */
+    std::string     token_;
+    std::vector<char> stringBuffer_;
+    size_t          offset_ = 0;
+};
+
+NS_SMARTJSON_END
@@ -0,0 +1,115 @@
+﻿#include "sj_json_lines.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+NS_SMARTJSON_BEGIN
+
+JsonLinesParser::JsonLinesParser(size_t threadCount, IAllocator *allocator)
+    : IParser(allocator)
+    , pool_(threadCount)
+{
+}
+
+bool JsonLinesParser::doParse()
+{
+    errorLine_ = 0;
+    recordCount_ = 0;
+    if (!callback_)
+    {
+        root_.setArray(allocator_);
+    }
+
+    // 限制同时解析的批数，回调模式下内存占用不会随文件大小增长
+    const size_t maxPending = pool_.size() * 2;
+    std::deque<std::future<Batch>> pending;
+    size_t lines = 0;
+
+    const char *p = begin_;
+    while (true)
+    {
+        while (p != end_ && pending.size() < maxPending)
+        {
+            const char *batchEnd = end_;
+            if ((size_t)(end_ - p) > batchSize_)
+            {
+                batchEnd = (const char*)memchr(p + batchSize_, '\n', end_ - p - batchSize_);
+                batchEnd = batchEnd != nullptr ? batchEnd + 1 : end_;
+            }
+
+            const char *batchBegin = p;
+            pending.push_back(pool_.submit([this, batchBegin, batchEnd]()
+            {
+                return parseBatch(batchBegin, batchEnd);
+            }));
+            p = batchEnd;
+        }
+
+        if (pending.empty())
+        {
+            break;
+        }
+
+        Batch batch = pending.front().get();
+        pending.pop_front();
+
+        // 出错后不再提交新的任务，只等待已提交的任务完成
+        if (errorCode_ != RC_OK)
+        {
+            continue;
+        }
+        if (batch.errorCode != RC_OK)
+        {
+            onError(batch.errorCode);
+            errorLine_ = lines + batch.lines;
+            p = end_;
+            continue;
+        }
+        lines += batch.lines;
+
+        for (const Node &record : batch.records.refArray())
+        {
+            if (callback_)
+            {
+                if (!callback_(recordCount_, record))
+                {
+                    onError(RC_HANDLER_ABORTED);
+                    p = end_;
+                    break;
+                }
+            }
+            else
+            {
+                root_.pushBack(record);
+            }
+            ++recordCount_;
+        }
+    }
+    return errorCode_ == RC_OK;
+}
+
+JsonLinesParser::Batch JsonLinesParser::parseBatch(const char *begin, const char *end) const
+{
+    IAllocator *allocator = allocatorFactory_ ? allocatorFactory_() : new IAllocator();
+
+    Parser parser(allocator);
+    parser.jsonLines_ = true;
+    parser.maxDepth_ = maxDepth_;
+    parser.presize_ = presize_;
+
+    Batch batch;
+    if (parser.parseFromData(begin, end - begin))
+    {
+        batch.records = parser.getRoot();
+        batch.lines = std::count(begin, end, '\n');
+    }
+    else
+    {
+        batch.errorCode = parser.getErrorCode();
+        batch.lines = parser.getLine();
+    }
+    return batch;
+}
+
+NS_SMARTJSON_END
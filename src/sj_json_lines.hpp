@@ -0,0 +1,64 @@
+﻿#pragma once
+#include "sj_parser.hpp"
+#include "sj_thread_pool.hpp"
+
+#include <functional>
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  并行的JSON Lines(NDJSON)解析器，每行是一个独立的json值。
+ *  输入数据按行切分成若干批，由线程池并行解析，结果按照原始顺序输出：
+ *  默认保存到根节点数组中；设置了回调函数时，在调用parse的线程上依次回调每条记录。
+ *  因为引用计数不是线程安全的，每批数据都使用独立的分配器创建节点，
+ *  解析线程之间不会竞争同一个分配器。
+ */
+class JsonLinesParser : public IParser
+{
+    SJ_DISABLE_COPY_ASSIGN(JsonLinesParser);
+public:
+    /** 记录的回调函数，index从0开始。返回false会终止解析 */
+    typedef std::function<bool(size_t index, const Node &record)> Callback;
+
+    /** 创建每批数据使用的分配器。会在解析线程中调用，需要是线程安全的 */
+    typedef std::function<IAllocator*()> AllocatorFactory;
+
+    /** threadCount为0时，使用硬件支持的并发线程数。allocator只用于创建根节点 */
+    explicit JsonLinesParser(size_t threadCount = 0, IAllocator *allocator = nullptr);
+
+    void setCallback(const Callback &callback) { callback_ = callback; }
+
+    /** 出错的行号，从1开始 */
+    size_t getErrorLine() const { return errorLine_; }
+
+    /** 成功解析的记录数 */
+    size_t getRecordCount() const { return recordCount_; }
+
+protected:
+    bool doParse() override;
+
+public:
+    /** 每批数据的大致字节数，在此之后的第一个换行处切分 */
+    size_t          batchSize_ = 1024 * 1024;
+
+    /** 为空时，每批数据使用一个新的IAllocator */
+    AllocatorFactory allocatorFactory_;
+
+private:
+    struct Batch
+    {
+        Node        records;
+        int         errorCode = RC_OK;
+        /** 成功时是包含的行数，失败时是出错的行号 */
+        size_t      lines = 0;
+    };
+
+    Batch parseBatch(const char *begin, const char *end) const;
+
+    ThreadPool      pool_;
+    Callback        callback_;
+    size_t          errorLine_ = 0;
+    size_t          recordCount_ = 0;
+};
+
+NS_SMARTJSON_END
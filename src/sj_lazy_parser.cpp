@@ -0,0 +1,288 @@
+﻿#include "sj_lazy_parser.hpp"
+#include "sj_source_buffer.hpp"
+
+#include <cstring>
+
+NS_SMARTJSON_BEGIN
+
+namespace
+{
+    Node createLazyNode(IAllocator *allocator, SourceBuffer *source, const char *begin, const char *end);
+
+    /** 跳过一个完整的数组或字典，p指向起始符。输入数据已经校验过，只需要匹配括号，并跳过字符串和注释 */
+    const char* skipContainer(const char *p, const char *end)
+    {
+        int level = 0;
+        while (p != end)
+        {
+            char ch = *p++;
+            switch (ch)
+            {
+            case '{':
+            case '[':
+                ++level;
+                break;
+
+            case '}':
+            case ']':
+                if (--level == 0)
+                {
+                    return p;
+                }
+                break;
+
+            case '"':
+                while (p != end && *p != '"')
+                {
+                    p += (*p == '\\' && p + 1 != end) ? 2 : 1;
+                }
+                if (p != end)
+                {
+                    ++p;
+                }
+                break;
+
+            case '/':
+                if (p != end && *p == '/')
+                {
+                    p = (const char*)memchr(p, '\n', end - p);
+                    if (p == nullptr)
+                    {
+                        return end;
+                    }
+                }
+                else if (p != end && *p == '*')
+                {
+                    for (++p; p != end; ++p)
+                    {
+                        if (*p == '*' && p + 1 != end && p[1] == '/')
+                        {
+                            p += 2;
+                            break;
+                        }
+                    }
+                }
+                break;
+
+            default:
+                break;
+            }
+        }
+        return end;
+    }
+
+    /** 只解析容器的直接子节点，子容器仍然延迟创建 */
+    class LevelParser : public Parser
+    {
+    public:
+        LevelParser(IObjectValue *container, SourceBuffer *source)
+            : Parser(container->getAllocator())
+            , container_(container)
+            , buffer_(source)
+        {}
+
+    protected:
+        bool doParse() override
+        {
+            nextToken_ = 0;
+
+            Node node(container_);
+            int ch = nextToken();
+            if (ch == '{')
+            {
+                return parseLazyDict(node);
+            }
+            if (ch == '[')
+            {
+                return parseLazyArray(node);
+            }
+            return onError(RC_INVALID_JSON);
+        }
+
+        bool parseLazyValue(Node &node)
+        {
+            int ch = aheadToken();
+            while (ch == '/')
+            {
+                nextToken();
+                if (!parseComment())
+                {
+                    return false;
+                }
+                ch = aheadToken();
+            }
+
+            if (ch == '{' || ch == '[')
+            {
+                nextToken();
+                const char *begin = cursor_ - 1;
+                cursor_ = skipContainer(begin, end_);
+                node = createLazyNode(allocator_, buffer_, begin, cursor_);
+                return true;
+            }
+            return parseValue(node);
+        }
+
+        bool parseLazyDict(Node &node)
+        {
+            if (aheadToken() == '}')
+            {
+                return true;
+            }
+
+            while (true)
+            {
+                Node key, value;
+                if (!parseValue(key) || nextToken() != ':' || !parseLazyValue(value))
+                {
+                    return onError(RC_INVALID_DICT);
+                }
+                node.emplaceMember(std::move(key), std::move(value));
+
+                int ch = nextToken();
+                if (ch == '}')
+                {
+                    return true;
+                }
+                if (ch != ',')
+                {
+                    return onError(RC_INVALID_DICT);
+                }
+            }
+        }
+
+        bool parseLazyArray(Node &node)
+        {
+            if (aheadToken() == ']')
+            {
+                return true;
+            }
+
+            while (true)
+            {
+                Node value;
+                if (!parseLazyValue(value))
+                {
+                    return onError(RC_INVALID_ARRAY);
+                }
+                node.pushBack(value);
+
+                int ch = nextToken();
+                if (ch == ']')
+                {
+                    return true;
+                }
+                if (ch != ',')
+                {
+                    return onError(RC_INVALID_ARRAY);
+                }
+            }
+        }
+
+    private:
+        IObjectValue*   container_;
+        SourceBuffer*   buffer_;
+    };
+
+    /** 容器在输入数据中的范围[begin, end)，包含两端的括号 */
+    class LazyContent : public ILazyContent
+    {
+    public:
+        LazyContent(SourceBuffer *source, const char *begin, const char *end)
+            : source_(source)
+            , begin_(begin)
+            , end_(end)
+        {
+            source_->retain();
+        }
+
+        ~LazyContent()
+        {
+            source_->release();
+        }
+
+        void load(IObjectValue *container) override
+        {
+            LevelParser parser(container, source_);
+            parser.parse(begin_, end_ - begin_);
+        }
+
+    private:
+        SourceBuffer*   source_;
+        const char*     begin_;
+        const char*     end_;
+    };
+
+    Node createLazyNode(IAllocator *allocator, SourceBuffer *source, const char *begin, const char *end)
+    {
+        if (*begin == '{')
+        {
+            DictValue *dict = allocator->createDict(0);
+            dict->lazy = new LazyContent(source, begin, end);
+            return Node(dict);
+        }
+        else
+        {
+            ArrayValue *array = allocator->createArray(0);
+            array->lazy = new LazyContent(source, begin, end);
+            return Node(array);
+        }
+    }
+
+    inline bool isSpace(char ch)
+    {
+        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+    }
+}
+
+LazyParser::LazyParser(IAllocator *allocator)
+    : Parser(allocator)
+{
+    inSitu_ = true;
+}
+
+bool LazyParser::doParse()
+{
+    if (handler_ != nullptr || jsonLines_)
+    {
+        return Parser::doParse();
+    }
+
+    // 第一遍只校验格式，不创建节点，也不原地解码字符串
+    IHandler validator;
+    SourceBuffer *source = source_;
+    source_ = nullptr;
+    handler_ = &validator;
+    bool ret = Parser::doParse();
+    handler_ = nullptr;
+    source_ = source;
+    if (!ret)
+    {
+        return false;
+    }
+
+    if (source == nullptr)
+    {
+        source = SourceBuffer::createFromData(begin_, end_ - begin_);
+    }
+    source->retain();
+
+    const char *first = begin_;
+    while (isSpace(*first))
+    {
+        ++first;
+    }
+    const char *last = end_;
+    while (isSpace(last[-1]))
+    {
+        --last;
+    }
+
+    const char *data = source->data();
+    root_ = createLazyNode(allocator_, source, data + (first - begin_), data + (last - begin_));
+
+    source->release();
+    return true;
+}
+
+NS_SMARTJSON_END
@@ -0,0 +1,28 @@
+﻿#pragma once
+#include "sj_parser.hpp"
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  按需创建节点的解析器(lazy DOM)。
+ *  解析时先完整地校验一遍格式，但不创建任何子节点，根节点只记录它在输入数据中的范围。
+ *  数组和字典第一次被访问时(operator[]、findMemberByPath、遍历等)，才解析它的直接子节点，
+ *  子容器同样只记录范围，因此只读取一小部分数据时，可以省去大部分解析时间和内存。
+ *
+ *  输入数据由引用计数的SourceBuffer保存，直到所有未展开的容器都被释放。
+ *  默认开启inSitu_，parseFromFile以写时复制的方式映射文件，parseFromData会拷贝一份输入数据，
+ *  直接调用parse(data, length)时也会拷贝。解析过程中不会修改输入数据。
+ *  注意：展开容器会修改节点，即使只是读取，也不能在多个线程中同时访问未展开的节点。
+ *  设置了handler或jsonLines_时，与Parser相同。
+ */
+class LazyParser : public Parser
+{
+    SJ_DISABLE_COPY_ASSIGN(LazyParser);
+public:
+    explicit LazyParser(IAllocator *allocator = nullptr);
+
+protected:
+    bool doParse() override;
+};
+
+NS_SMARTJSON_END
@@ -0,0 +1,168 @@
+﻿#include "sj_mapped_file.hpp"
+
+#include <cstdio>
+
+#if SJ_USE_MMAP
+#   ifdef _WIN32
+#       ifndef WIN32_LEAN_AND_MEAN
+#           define WIN32_LEAN_AND_MEAN
+#       endif
+#       include <windows.h>
+#   else
+#       include <fcntl.h>
+#       include <unistd.h>
+#       include <sys/mman.h>
+#       include <sys/stat.h>
+#   endif
+#endif
+
+NS_SMARTJSON_BEGIN
+
+static char s_emptyBuffer[1] = { 0 };
+
+bool MappedFile::open(const char *fileName, bool sequential, bool writable)
+{
+    close();
+
+#if SJ_USE_MMAP && defined(_WIN32)
+    HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    isOpen_ = true;
+    size_ = (size_t)fileSize.QuadPart;
+    if (size_ == 0)
+    {
+        // 空文件不能被映射
+        CloseHandle(file);
+        data_ = s_emptyBuffer;
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, writable ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+    void *view = mapping != NULL ? MapViewOfFile(mapping, writable ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (view == NULL)
+    {
+        if (mapping != NULL)
+        {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        isOpen_ = false;
+        return readToBuffer(fileName);
+    }
+
+    fileHandle_ = file;
+    mappingHandle_ = mapping;
+    data_ = static_cast<char*>(view);
+    isMapped_ = true;
+    return true;
+
+#elif SJ_USE_MMAP
+    int fd = ::open(fileName, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        ::close(fd);
+        return readToBuffer(fileName);
+    }
+
+    isOpen_ = true;
+    size_ = (size_t)st.st_size;
+    if (size_ == 0)
+    {
+        // 空文件不能被映射
+        ::close(fd);
+        data_ = s_emptyBuffer;
+        return true;
+    }
+
+    int prot = writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void *addr = mmap(nullptr, size_, prot, MAP_PRIVATE, fd, 0);
+    // 映射建立后，文件描述符就可以关闭了
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+        isOpen_ = false;
+        return readToBuffer(fileName);
+    }
+
+#ifdef MADV_SEQUENTIAL
+    if (sequential)
+    {
+        madvise(addr, size_, MADV_SEQUENTIAL);
+        madvise(addr, size_, MADV_WILLNEED);
+    }
+#endif
+
+    data_ = static_cast<char*>(addr);
+    isMapped_ = true;
+    return true;
+
+#else
+    (void)sequential;
+    (void)writable;
+    return readToBuffer(fileName);
+#endif
+}
+
+void MappedFile::close()
+{
+    if (isMapped_)
+    {
+#if SJ_USE_MMAP && defined(_WIN32)
+        UnmapViewOfFile(data_);
+        CloseHandle(mappingHandle_);
+        CloseHandle(fileHandle_);
+        mappingHandle_ = nullptr;
+        fileHandle_ = nullptr;
+#elif SJ_USE_MMAP
+        munmap(data_, size_);
+#endif
+    }
+
+    std::vector<char>().swap(buffer_);
+    data_ = nullptr;
+    size_ = 0;
+    isOpen_ = false;
+    isMapped_ = false;
+}
+
+bool MappedFile::readToBuffer(const char *fileName)
+{
+    FILE *fp = fopen(fileName, "rb");
+    if (fp == nullptr)
+    {
+        return false;
+    }
+
+    char block[64 * 1024];
+    size_t n;
+    while ((n = fread(block, 1, sizeof(block), fp)) > 0)
+    {
+        buffer_.insert(buffer_.end(), block, block + n);
+    }
+    fclose(fp);
+
+    isOpen_ = true;
+    size_ = buffer_.size();
+    data_ = size_ > 0 ? buffer_.data() : s_emptyBuffer;
+    return true;
+}
+
+NS_SMARTJSON_END
@@ -0,0 +1,53 @@
+﻿#pragma once
+#include "sj_config.hpp"
+
+#include <cstddef>
+#include <vector>
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  只读的内存映射文件。
+ *  解析器直接从页缓存中读取数据，避免了文件流的缓冲和拷贝。
+ *  对于不支持内存映射的平台，会把整个文件读取到内存中。
+ */
+class MappedFile
+{
+    SJ_DISABLE_COPY_ASSIGN(MappedFile);
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    /** 打开并映射文件。
+     *  @param sequential 提示系统将顺序访问文件，以便预读后续页面。
+     *  @param writable   以写时复制的方式映射，修改的内容不会写回到文件中。
+     */
+    bool open(const char *fileName, bool sequential = true, bool writable = false);
+    void close();
+
+    bool isOpen() const { return isOpen_; }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    /** 只有以writable方式打开的文件，才可以修改数据 */
+    char* mutableData() { return data_; }
+
+private:
+    bool readToBuffer(const char *fileName);
+
+    char*           data_ = nullptr;
+    size_t          size_ = 0;
+    bool            isOpen_ = false;
+    bool            isMapped_ = false;
+
+#ifdef _WIN32
+    void*           fileHandle_ = nullptr;
+    void*           mappingHandle_ = nullptr;
+#endif
+
+    /** 不能映射文件时，使用此缓冲区存放文件内容 */
+    std::vector<char> buffer_;
+};
+
+NS_SMARTJSON_END
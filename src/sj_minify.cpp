@@ -0,0 +1,242 @@
+﻿#include "sj_minify.hpp"
+#include "sj_simd.hpp"
+#include "sj_string_scan.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+NS_SMARTJSON_BEGIN
+
+namespace
+{
+    const size_t BLOCK_SIZE = 64;
+
+    inline bool isSpace(char ch)
+    {
+        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+    }
+
+    /** 低n位为1的掩码 */
+    inline uint64_t lowBits(size_t n)
+    {
+        return n >= 64 ? ~0ull : ((uint64_t)1 << n) - 1;
+    }
+
+    class Minifier
+    {
+    public:
+        Minifier(const char *data, size_t length, std::string &output)
+            : begin_(data)
+            , end_(data + length)
+            , output_(output)
+        {}
+
+        bool run();
+
+    private:
+        size_t minifyBlock(const char *block, size_t size);
+        const char* minifyScalar(const char *p, const char *stop);
+        const char* skipComment(const char *p);
+
+        void appendBits(const char *block, uint64_t bits);
+        void appendCloser(char ch);
+
+        const char*     begin_;
+        const char*     end_;
+        std::string&    output_;
+        ScanState       state_;
+        void (*classify_)(const uint8_t*, BlockMasks&) = getSimdKernels().classifyBlock;
+    };
+
+    bool Minifier::run()
+    {
+        output_.clear();
+        output_.reserve(end_ - begin_);
+
+        const char *p = begin_;
+        while (p != end_)
+        {
+            size_t size = std::min((size_t)(end_ - p), BLOCK_SIZE);
+            const char *block = p;
+
+            // 最后不足一个分块的部分，使用空白字符补齐
+            char tail[BLOCK_SIZE];
+            if (size < BLOCK_SIZE)
+            {
+                memset(tail, ' ', BLOCK_SIZE);
+                memcpy(tail, p, size);
+                block = tail;
+            }
+
+            size_t n = minifyBlock(block, size);
+            if (n == size)
+            {
+                p += size;
+                continue;
+            }
+
+            // 注释之后的部分逐字节处理，直到离开当前分块
+            p = minifyScalar(p + n, p + size);
+            if (p == nullptr)
+            {
+                return false;
+            }
+            state_ = ScanState();
+        }
+        return state_.inString == 0;
+    }
+
+    /** 处理一个分块，遇到字符串外的'/'时停止，返回处理的字节数 */
+    size_t Minifier::minifyBlock(const char *block, size_t size)
+    {
+        BlockMasks m;
+        classify_(reinterpret_cast<const uint8_t*>(block), m);
+
+        uint64_t quote;
+        uint64_t inString = findStrings(m, state_, quote);
+
+        // 第一个注释之前，字符串的范围都是准确的
+        uint64_t slash = m.slash & ~inString;
+        size_t n = slash != 0 ? (size_t)trailingZeros64(slash) : size;
+
+        uint64_t keep = ~(m.whitespace & ~inString) & lowBits(n);
+        uint64_t op = m.op & ~inString & keep;
+        while (op != 0)
+        {
+            int i = trailingZeros64(op);
+            op &= op - 1;
+            if (block[i] == '}' || block[i] == ']')
+            {
+                appendBits(block, keep & lowBits(i));
+                appendCloser(block[i]);
+                keep &= ~lowBits(i + 1);
+            }
+        }
+        appendBits(block, keep);
+        return n;
+    }
+
+    /** 逐字节处理[p, stop)，字符串和注释会完整处理，因此返回的位置可能超过stop。出错时返回nullptr */
+    const char* Minifier::minifyScalar(const char *p, const char *stop)
+    {
+        while (p < stop)
+        {
+            char ch = *p;
+            if (isSpace(ch))
+            {
+                ++p;
+            }
+            else if (ch == '"')
+            {
+                const char *q = p + 1;
+                while (true)
+                {
+                    q = findStringSpecial(q, end_);
+                    if (q == end_)
+                    {
+                        return nullptr;
+                    }
+                    else if (*q == '"')
+                    {
+                        break;
+                    }
+                    else if (*q == '\\')
+                    {
+                        if (end_ - q < 2)
+                        {
+                            return nullptr;
+                        }
+                        q += 2;
+                    }
+                    else
+                    {
+                        ++q;
+                    }
+                }
+                output_.append(p, q + 1);
+                p = q + 1;
+            }
+            else if (ch == '/')
+            {
+                p = skipComment(p);
+                if (p == nullptr)
+                {
+                    return nullptr;
+                }
+            }
+            else if (ch == '}' || ch == ']')
+            {
+                appendCloser(ch);
+                ++p;
+            }
+            else
+            {
+                output_.push_back(ch);
+                ++p;
+            }
+        }
+        return p;
+    }
+
+    /** 跳过以p开头的注释，返回注释之后的位置 */
+    const char* Minifier::skipComment(const char *p)
+    {
+        if (end_ - p < 2)
+        {
+            return nullptr;
+        }
+
+        if (p[1] == '/')
+        {
+            const char *q = (const char*)memchr(p + 2, '\n', end_ - p - 2);
+            return q != nullptr ? q + 1 : end_;
+        }
+        else if (p[1] == '*')
+        {
+            for (const char *q = p + 2; q < end_; ++q)
+            {
+                q = (const char*)memchr(q, '*', end_ - q);
+                if (q == nullptr || q + 1 == end_)
+                {
+                    break;
+                }
+                if (q[1] == '/')
+                {
+                    return q + 2;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    void Minifier::appendBits(const char *block, uint64_t bits)
+    {
+        // 按连续的片段拷贝
+        while (bits != 0)
+        {
+            int start = trailingZeros64(bits);
+            uint64_t rest = ~(bits >> start);
+            size_t length = rest != 0 ? (size_t)trailingZeros64(rest) : 64 - start;
+            output_.append(block + start, length);
+            bits &= ~(lowBits(length) << start);
+        }
+    }
+
+    /** 压缩后的结果中没有空白和注释，末尾的','一定紧挨着'}'或']' */
+    void Minifier::appendCloser(char ch)
+    {
+        if (!output_.empty() && output_.back() == ',')
+        {
+            output_.pop_back();
+        }
+        output_.push_back(ch);
+    }
+}
+
+bool minify(const char *data, size_t length, std::string &output)
+{
+    Minifier minifier(data, length, output);
+    return minifier.run();
+}
+
+NS_SMARTJSON_END
@@ -0,0 +1,23 @@
+﻿#pragma once
+#include "sj_config.hpp"
+
+#include <cstddef>
+#include <string>
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  压缩json文本：删除字符串外的空白字符、行注释和块注释，以及数组和字典末尾多余的','。
+ *  不构造节点树，也不检查语法，字符串的内容原样保留。
+ *  使用结构字符索引相同的SIMD函数，每次对64个字节分类，只有遇到注释时才逐字节处理。
+ *  @param output 压缩后的结果，原有的内容会被清空。
+ *  @return 字符串或块注释没有闭合，或者'/'后面不是注释时，返回false。
+ */
+bool minify(const char *data, size_t length, std::string &output);
+
+inline bool minify(const std::string &input, std::string &output)
+{
+    return minify(input.data(), input.size(), output);
+}
+
+NS_SMARTJSON_END
@@ -34,6 +34,11 @@ StringValue* IAllocator::createString(const char *str, size_t size, BufferType t
     }
 }
 
+StringValue* IAllocator::createSharedString(const char *str, size_t size, IRefCout *owner)
+{
+    return new SharedStringValue(str, size, owner, this);
+}
+
 ArrayValue* IAllocator::createArray(size_t capacity)
 {
     ArrayValue *ret = new ArrayValue(this);
@@ -252,6 +257,7 @@ int StringValue::compare(const char *str, size_t length) const
 
 IObjectValue* ArrayValue::deepClone() const
 {
+    load();
     ArrayValue *ret = allocator_->createArray(imp.size());
     for (const Node &v : imp)
     {
@@ -262,6 +268,7 @@ IObjectValue* ArrayValue::deepClone() const
 
 Array::iterator ArrayValue::find(const Node &value)
 {
+    load();
     for (auto it = imp.begin(); it != imp.end(); ++it)
     {
         if (value == *it)
@@ -278,6 +285,7 @@ Array::iterator ArrayValue::find(const Node &value)
 
 IObjectValue* DictValue::deepClone() const
 {
+    load();
     DictValue *ret = allocator_->createDict(imp.size());
     for (const auto &pair : imp)
     {
@@ -690,6 +698,7 @@ const Node& Node::findMemberByPath(const char *keyPath, size_t keyLength) const
         const char *pos = std::find(begin, end, '/');
 
         DictValue *dict = pNode->value_.pd;
+        dict->load();
         StringValue *name = dict->getAllocator()->createString(begin, pos - begin, BT_NOT_CARE);
         auto iterator = dict->imp.find(Node(name));
         if (iterator == dict->imp.end())
@@ -723,6 +732,7 @@ bool Node::hasMemberByPath(const char *keyPath, size_t keyLength) const
         const char *pos = std::find(begin, end, '/');
 
         DictValue *dict = pNode->value_.pd;
+        dict->load();
         StringValue *name = dict->getAllocator()->createString(begin, pos - begin, BT_NOT_CARE);
         auto iterator = dict->imp.find(Node(name));
         if (iterator == dict->imp.end())
@@ -754,6 +764,7 @@ bool Node::setMemberByPath(const char *keyPath, size_t keyLength, const Node &va
         const char *pos = std::find(begin, end, '/');
 
         DictValue *dict = pNode->value_.pd;
+        dict->load();
         Node name = dict->getAllocator()->createString(begin, pos - begin, BT_MAKE_COPY);
         auto iterator = dict->imp.find(name);
         if (iterator != dict->imp.end())
@@ -792,6 +803,7 @@ bool Node::removeMemberByPath(const char * keyPath, size_t keyLength)
         const char *pos = std::find(begin, end, '/');
 
         DictValue *dict = pNode->value_.pd;
+        dict->load();
         StringValue *name = dict->getAllocator()->createString(begin, pos - begin, BT_NOT_CARE);
         auto iterator = dict->imp.find(Node(name));
         if (iterator == dict->imp.end())
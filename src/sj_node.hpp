@@ -4,6 +4,7 @@
 #include <cfloat>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -66,6 +67,14 @@ enum ResultCode
     RC_INVALID_CHAR,
     /** 无效的Unicode字符格式。\u格式需要4个16进制字符，如: \uabcd */
     RC_INVALID_UNICODE,
+    /** 事件处理器(IHandler)终止了解析 */
+    RC_HANDLER_ABORTED,
+    /** 数组和字典的嵌套深度超过了maxDepth_ */
+    RC_TOO_DEEP,
+    /** 字符串不是合法的UTF-8编码，只在开启了UTF-8校验时返回 */
+    RC_INVALID_UTF8,
+    /** 写入输出目标失败，如磁盘已满或者固定大小的缓冲区不够用 */
+    RC_WRITE_ERROR,
 };
 
 // predefine
@@ -137,6 +146,10 @@ public:
     ~IAllocator() = default;
     
     virtual StringValue* createString(const char *str, size_t size, BufferType type);
+    /** 创建引用外部缓冲区的字符串，字符串会持有owner的引用计数。
+     *  str[size]必须是'\0'。
+     */
+    virtual StringValue* createSharedString(const char *str, size_t size, IRefCout *owner);
     virtual ArrayValue* createArray(size_t capacity);
     virtual DictValue* createDict(size_t capacity);
     
@@ -207,6 +220,37 @@ private:
     mutable size_t  hash_;
 };
 
+/** 引用外部缓冲区的字符串，缓冲区的生命周期由owner的引用计数管理 */
+class SharedStringValue : public StringValue
+{
+    SJ_DISABLE_COPY_ASSIGN(SharedStringValue);
+public:
+    SharedStringValue(const char *str, size_t size, IRefCout *owner, IAllocator *allocator)
+        : StringValue(str, size, allocator)
+        , owner_(owner)
+    {
+        owner_->retain();
+    }
+
+    ~SharedStringValue()
+    {
+        owner_->release();
+    }
+
+private:
+    IRefCout*       owner_;
+};
+
+/** 延迟创建的容器内容，见LazyParser。
+ *  容器第一次被访问时，调用load创建子节点并保存到container中，然后销毁此对象。
+ */
+class ILazyContent
+{
+public:
+    virtual ~ILazyContent() = default;
+    virtual void load(IObjectValue *container) = 0;
+};
+
 class Node
 {
 public:
@@ -214,7 +258,7 @@ public:
     ~Node() { safeRelease(); }
 
     Node(const Node &other);
-    Node(Node &&other);
+    Node(Node &&other) noexcept;
 
     template <typename T>
     Node(const T &value);
@@ -237,6 +281,8 @@ public:
     bool isDict()   const { return type_ == T_DICT; }
     bool isNumber() const { return type_ == T_INT || type_ == T_FLOAT; }
     bool isPointer() const { return type_ > T_POINTER; }
+    /** 值是否只被这一个节点引用。修改独占的数组和字典不会影响其他节点 */
+    bool isUnique() const { return isPointer() && value_.p->getRefCount() == 1; }
 
     bool        asBool()    const;
     Integer     asInteger() const;
@@ -381,6 +427,12 @@ public: // dict
     void setMember(const std::string &key, const Node &val) { setMemberByPath(key.c_str(), key.size(), val); }
     void setMember(const Node &key, const Node &val);
 
+    /** 构建字典时使用的插入接口，解析器使用它创建字典。
+     *  与setMember不同，key不会被当作路径拆分，也不会被拷贝，key和val都会被移走。
+     *  key已经存在时，覆盖原来的值。
+     */
+    void emplaceMember(Node &&key, Node &&val);
+
     bool removeMember(const char *key) { return removeMemberByPath(key, strlen(key)); }
     bool removeMember(const std::string &key) { return removeMemberByPath(key.c_str(), key.size()); }
     bool removeMember(const Node &key);
@@ -433,14 +485,32 @@ class ArrayValue : public IObjectValue
 public:
     Array imp;
 
+    /** 非空时，imp还没有创建，第一次访问时才从输入数据中解析 */
+    mutable ILazyContent *lazy = nullptr;
+
     ArrayValue(IAllocator *allocator)
         : IObjectValue(allocator)
     {}
 
+    ~ArrayValue() { delete lazy; }
+
     ValueType getType() const override { return T_ARRAY; }
+
+    /** 创建延迟加载的子节点。直接访问imp之前，需要先调用此方法 */
+    void load() const
+    {
+        if (lazy != nullptr)
+        {
+            ILazyContent *content = lazy;
+            lazy = nullptr;
+            content->load(const_cast<ArrayValue*>(this));
+            delete content;
+        }
+    }
     
     IObjectValue* clone() const override
     {
+        load();
         ArrayValue *ret = allocator_->createArray(imp.size());
         ret->imp = imp;
         return ret;
@@ -465,12 +535,30 @@ class DictValue : public IObjectValue
 public:
     Dict imp;
 
+    /** 非空时，imp还没有创建，第一次访问时才从输入数据中解析 */
+    mutable ILazyContent *lazy = nullptr;
+
     DictValue(IAllocator *allocator)
         : IObjectValue(allocator)
     {}
 
+    ~DictValue() { delete lazy; }
+
+    /** 创建延迟加载的子节点。直接访问imp之前，需要先调用此方法 */
+    void load() const
+    {
+        if (lazy != nullptr)
+        {
+            ILazyContent *content = lazy;
+            lazy = nullptr;
+            content->load(const_cast<DictValue*>(this));
+            delete content;
+        }
+    }
+
     bool remove(const Node &value)
     {
+        load();
         auto it = imp.find(value);
         if (it != imp.end())
         {
@@ -484,6 +572,7 @@ public:
 
     IObjectValue* clone() const override
     {
+        load();
         DictValue *ret = allocator_->createDict(imp.size());
         ret->imp = imp;
         return ret;
@@ -562,7 +651,7 @@ inline Node::Node(const Node &other)
     }
 }
 
-inline Node::Node(Node &&other)
+inline Node::Node(Node &&other) noexcept
     : value_(other.value_)
     , type_(other.type_)
 {
@@ -737,12 +826,14 @@ inline StringValue* Node::rawString() const
 inline Array* Node::rawArray() const
 {
     SJ_ASSERT(isArray());
+    value_.pa->load();
     return &value_.pa->imp;
 }
 
 inline Dict* Node::rawDict() const
 {
     SJ_ASSERT(isDict());
+    value_.pd->load();
     return &value_.pd->imp;
 }
 
@@ -757,12 +848,14 @@ inline StringValue* Node::rawString()
 inline Array* Node::rawArray()
 {
     SJ_ASSERT(isArray());
+    value_.pa->load();
     return &value_.pa->imp;
 }
 
 inline Dict* Node::rawDict()
 {
     SJ_ASSERT(isDict());
+    value_.pd->load();
     return &value_.pd->imp;
 }
 
@@ -776,12 +869,14 @@ inline StringValue& Node::refString()
 inline Array& Node::refArray()
 {
     SJ_ASSERT(isArray());
+    value_.pa->load();
     return value_.pa->imp;
 }
 
 inline Dict& Node::refDict()
 {
     SJ_ASSERT(isDict());
+    value_.pd->load();
     return value_.pd->imp;
 }
 
@@ -795,12 +890,14 @@ inline const StringValue& Node::refString() const
 inline const Array& Node::refArray() const
 {
     SJ_ASSERT(isArray());
+    value_.pa->load();
     return value_.pa->imp;
 }
 
 inline const Dict& Node::refDict() const
 {
     SJ_ASSERT(isDict());
+    value_.pd->load();
     return value_.pd->imp;
 }
 
@@ -967,6 +1064,11 @@ inline void Node::eraseMember(DictIterator it)
     refDict().erase(it);
 }
 
+inline void Node::emplaceMember(Node &&key, Node &&val)
+{
+    refDict()[std::move(key)] = std::move(val);
+}
+
 template <typename T>
 inline T Node::get(const char *key, T defaultValue) const
 {
@@ -0,0 +1,41 @@
+﻿#pragma once
+#include "sj_config.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+NS_SMARTJSON_BEGIN
+
+/** 数字的解析结果 */
+struct NumberResult
+{
+    /** 为true时，数值存储在real中；否则存储在integer中 */
+    bool        isFloat = false;
+    int64_t     integer = 0;
+    double      real = 0.0;
+};
+
+/**
+ *  解析十进制数字，格式为：-?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+ *  整数部分每次处理8位数字(SWAR)。浮点数先尝试Clinger快速路径和Eisel-Lemire算法，
+ *  无法确定舍入方向时，使用大整数精确比较，结果与strtod一致(正确舍入)。
+ *  没有小数和指数部分、并且在int64_t范围内的数字，解析为整数。
+ *  本函数不检查数字后面的字符，由调用者判断数字是否正确结束。
+ *  @return 成功返回数字结束的位置；失败返回nullptr。
+ */
+const char* parseNumber(const char *begin, const char *end, NumberResult &result);
+
+/**
+ *  解析Parser支持的扩展格式：在parseNumber的基础上，允许有'+'号，
+ *  以及0x、0o、0b开头的16进制、8进制和2进制整数。
+ *  @return 成功返回数字结束的位置；失败返回nullptr。
+ */
+const char* parseExtendedNumber(const char *begin, const char *end, NumberResult &result);
+
+/**
+ *  将 mantissa * 10^exponent 转换为正确舍入的double。
+ *  mantissa需要是完整的十进制数，不能被截断过。
+ */
+double decimalToDouble(uint64_t mantissa, int exponent);
+
+NS_SMARTJSON_END
@@ -0,0 +1,439 @@
+﻿#include "sj_number_format.hpp"
+
+#include <cstring>
+
+NS_SMARTJSON_BEGIN
+
+namespace
+{
+    const char DIGIT_PAIRS[201] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    ///////////////////////////////////////////////////////////////////
+    // Grisu2
+    // Florian Loitsch, Printing Floating-Point Numbers Quickly and Accurately with Integers.
+    // 输出的数字总能精确还原为原来的值，绝大多数情况下也是最短的。
+    ///////////////////////////////////////////////////////////////////
+
+    /** IEEE浮点数的格式 */
+    template<typename T>
+    struct FloatTraits;
+
+    template<>
+    struct FloatTraits<double>
+    {
+        typedef uint64_t Bits;
+        static const int SIGNIFICAND_SIZE = 52;
+        static const int EXPONENT_BIAS = 0x3FF + SIGNIFICAND_SIZE;
+        static const int EXPONENT_MASK = 0x7FF;
+    };
+
+    template<>
+    struct FloatTraits<float>
+    {
+        typedef uint32_t Bits;
+        static const int SIGNIFICAND_SIZE = 23;
+        static const int EXPONENT_BIAS = 0x7F + SIGNIFICAND_SIZE;
+        static const int EXPONENT_MASK = 0xFF;
+    };
+
+    /** f * 2^e，f使用64位无符号整数 */
+    struct DiyFp
+    {
+        uint64_t    f;
+        int         e;
+
+        DiyFp(uint64_t f_, int e_) : f(f_), e(e_) {}
+
+        DiyFp operator - (const DiyFp &rhs) const
+        {
+            return DiyFp(f - rhs.f, e);
+        }
+
+        /** 乘积的高64位，四舍五入 */
+        DiyFp operator * (const DiyFp &rhs) const
+        {
+            const uint64_t M32 = 0xFFFFFFFFu;
+            uint64_t a = f >> 32, b = f & M32;
+            uint64_t c = rhs.f >> 32, d = rhs.f & M32;
+            uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+            uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+            tmp += 1u << 31;
+            return DiyFp(ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), e + rhs.e + 64);
+        }
+
+        DiyFp normalize() const
+        {
+            DiyFp res = *this;
+            while ((res.f & ((uint64_t)1 << 63)) == 0)
+            {
+                res.f <<= 1;
+                res.e--;
+            }
+            return res;
+        }
+    };
+
+    /** 将value拆分为DiyFp，同时计算与相邻浮点数的中点m-和m+，m+是规格化的，m-与m+的指数相同 */
+    template<typename T>
+    DiyFp toDiyFp(T value, DiyFp &minus, DiyFp &plus)
+    {
+        typedef FloatTraits<T> Traits;
+        typedef typename Traits::Bits Bits;
+        const Bits hiddenBit = (Bits)1 << Traits::SIGNIFICAND_SIZE;
+
+        Bits bits;
+        memcpy(&bits, &value, sizeof(bits));
+        int biasedExponent = (int)(bits >> Traits::SIGNIFICAND_SIZE) & Traits::EXPONENT_MASK;
+        uint64_t significand = bits & (hiddenBit - 1);
+
+        DiyFp v(significand, 1 - Traits::EXPONENT_BIAS);
+        if (biasedExponent != 0)
+        {
+            v = DiyFp(significand + hiddenBit, biasedExponent - Traits::EXPONENT_BIAS);
+        }
+
+        plus = DiyFp((v.f << 1) + 1, v.e - 1);
+        while ((plus.f & ((uint64_t)hiddenBit << 1)) == 0)
+        {
+            plus.f <<= 1;
+            plus.e--;
+        }
+        const int shift = 64 - Traits::SIGNIFICAND_SIZE - 2;
+        plus.f <<= shift;
+        plus.e -= shift;
+
+        // 有效数字是2的幂时，下方的间隔只有上方的一半
+        minus = v.f == hiddenBit ? DiyFp((v.f << 2) - 1, v.e - 2) : DiyFp((v.f << 1) - 1, v.e - 1);
+        minus.f <<= minus.e - plus.e;
+        minus.e = plus.e;
+        return v.normalize();
+    }
+
+    /** 10^k的近似值，k = -348 + 8 * i */
+    const uint64_t CACHED_POWERS_F[] =
+    {
+        0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+        0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+        0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+        0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+        0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+        0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+        0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+        0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+        0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+        0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+        0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+        0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+        0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+        0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+        0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+        0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+        0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+        0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+        0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+        0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+        0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+        0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+    };
+
+    const int16_t CACHED_POWERS_E[] =
+    {
+        -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+        -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+        -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+        -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+        56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+        375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+        694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+        1013, 1039, 1066
+    };
+
+    /** 选择10^-k，使乘积的指数在[-60, -32]之间 */
+    inline DiyFp getCachedPower(int e, int &k)
+    {
+        double dk = (-61 - e) * 0.30102999566398114 + 347;
+        int ik = (int)dk;
+        if (dk - ik > 0.0)
+        {
+            ++ik;
+        }
+
+        unsigned index = (unsigned)((ik >> 3) + 1);
+        k = -(-348 + (int)(index << 3));
+        return DiyFp(CACHED_POWERS_F[index], CACHED_POWERS_E[index]);
+    }
+
+    inline void grisuRound(char *buffer, int length, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wpw)
+    {
+        while (rest < wpw && delta - rest >= tenKappa &&
+            (rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw))
+        {
+            buffer[length - 1]--;
+            rest += tenKappa;
+        }
+    }
+
+    inline int countDecimalDigits(uint32_t n)
+    {
+        int count = 1;
+        for (uint32_t p = 10; count < 10 && n >= p; p *= 10)
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    /** 生成[W-, W+]之间尽量短的数字 */
+    void digitGen(const DiyFp &w, const DiyFp &mp, uint64_t delta, char *buffer, int &length, int &k)
+    {
+        static const uint32_t POW10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+        const DiyFp one((uint64_t)1 << -mp.e, mp.e);
+        const DiyFp wpw = mp - w;
+        uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+        uint64_t p2 = mp.f & (one.f - 1);
+        int kappa = countDecimalDigits(p1);
+        length = 0;
+
+        while (kappa > 0)
+        {
+            uint32_t d = p1 / POW10[kappa - 1];
+            p1 %= POW10[kappa - 1];
+            if (d != 0 || length != 0)
+            {
+                buffer[length++] = (char)('0' + d);
+            }
+            --kappa;
+
+            uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+            if (rest <= delta)
+            {
+                k += kappa;
+                grisuRound(buffer, length, delta, rest, (uint64_t)POW10[kappa] << -one.e, wpw.f);
+                return;
+            }
+        }
+
+        // 小数部分。scale = 10^-kappa，用于放大误差wpw
+        uint64_t scale = 1;
+        while (true)
+        {
+            p2 *= 10;
+            delta *= 10;
+            scale *= 10;
+            char d = (char)(p2 >> -one.e);
+            if (d != 0 || length != 0)
+            {
+                buffer[length++] = (char)('0' + d);
+            }
+            p2 &= one.f - 1;
+            --kappa;
+            if (p2 < delta)
+            {
+                k += kappa;
+                grisuRound(buffer, length, delta, p2, one.f, wpw.f * scale);
+                return;
+            }
+        }
+    }
+
+    template<typename T>
+    void grisu2(T value, char *buffer, int &length, int &k)
+    {
+        DiyFp minus(0, 0), plus(0, 0);
+        DiyFp v = toDiyFp(value, minus, plus);
+
+        DiyFp cached = getCachedPower(plus.e, k);
+        DiyFp w = v * cached;
+        DiyFp wp = plus * cached;
+        DiyFp wm = minus * cached;
+        wm.f++;
+        wp.f--;
+        digitGen(w, wp, wp.f - wm.f, buffer, length, k);
+    }
+
+    char* writeExponent(int k, char *buffer)
+    {
+        if (k < 0)
+        {
+            *buffer++ = '-';
+            k = -k;
+        }
+
+        if (k >= 100)
+        {
+            *buffer++ = (char)('0' + k / 100);
+            k %= 100;
+            memcpy(buffer, DIGIT_PAIRS + k * 2, 2);
+            buffer += 2;
+        }
+        else if (k >= 10)
+        {
+            memcpy(buffer, DIGIT_PAIRS + k * 2, 2);
+            buffer += 2;
+        }
+        else
+        {
+            *buffer++ = (char)('0' + k);
+        }
+        return buffer;
+    }
+
+    /** buffer中是length个数字，值为digits * 10^k，转换为最终的格式 */
+    char* prettify(char *buffer, int length, int k)
+    {
+        // 10^(kk-1) <= v < 10^kk
+        const int kk = length + k;
+        if (0 <= k && kk <= 21)
+        {
+            // 1234e7 -> 12340000000.0
+            for (int i = length; i < kk; ++i)
+            {
+                buffer[i] = '0';
+            }
+            buffer[kk] = '.';
+            buffer[kk + 1] = '0';
+            return buffer + kk + 2;
+        }
+        else if (0 < kk && kk <= 21)
+        {
+            // 1234e-2 -> 12.34
+            memmove(buffer + kk + 1, buffer + kk, length - kk);
+            buffer[kk] = '.';
+            return buffer + length + 1;
+        }
+        else if (-6 < kk && kk <= 0)
+        {
+            // 1234e-6 -> 0.001234
+            const int offset = 2 - kk;
+            memmove(buffer + offset, buffer, length);
+            buffer[0] = '0';
+            buffer[1] = '.';
+            for (int i = 2; i < offset; ++i)
+            {
+                buffer[i] = '0';
+            }
+            return buffer + length + offset;
+        }
+        else if (length == 1)
+        {
+            // 1e30
+            buffer[1] = 'e';
+            return writeExponent(kk - 1, buffer + 2);
+        }
+        else
+        {
+            // 1234e30 -> 1.234e33
+            memmove(buffer + 2, buffer + 1, length - 1);
+            buffer[1] = '.';
+            buffer[length + 1] = 'e';
+            return writeExponent(kk - 1, buffer + length + 2);
+        }
+    }
+
+    template<typename T>
+    size_t formatFloatImpl(char *buffer, T value)
+    {
+        typedef typename FloatTraits<T>::Bits Bits;
+        Bits bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        const Bits signBit = (Bits)1 << (sizeof(Bits) * 8 - 1);
+        const int exponent = (int)(bits >> FloatTraits<T>::SIGNIFICAND_SIZE) & FloatTraits<T>::EXPONENT_MASK;
+        const Bits significand = bits & (((Bits)1 << FloatTraits<T>::SIGNIFICAND_SIZE) - 1);
+
+        char *p = buffer;
+        if (exponent == FloatTraits<T>::EXPONENT_MASK)
+        {
+            if (significand != 0)
+            {
+                memcpy(p, "nan", 3);
+                return 3;
+            }
+            if (bits & signBit)
+            {
+                *p++ = '-';
+            }
+            memcpy(p, "inf", 3);
+            return p + 3 - buffer;
+        }
+
+        if (bits & signBit)
+        {
+            *p++ = '-';
+            bits &= ~signBit;
+        }
+
+        if (bits == 0)
+        {
+            memcpy(p, "0.0", 3);
+            return p + 3 - buffer;
+        }
+
+        memcpy(&value, &bits, sizeof(bits));
+        int length, k;
+        grisu2(value, p, length, k);
+        return prettify(p, length, k) - buffer;
+    }
+}
+
+size_t formatUInteger(char *buffer, uint64_t value)
+{
+    // 从低位开始写入临时缓冲区的末尾
+    char temp[24];
+    char *end = temp + sizeof(temp);
+    char *p = end;
+    while (value >= 100)
+    {
+        unsigned index = (unsigned)(value % 100) * 2;
+        value /= 100;
+        p -= 2;
+        memcpy(p, DIGIT_PAIRS + index, 2);
+    }
+
+    if (value >= 10)
+    {
+        p -= 2;
+        memcpy(p, DIGIT_PAIRS + value * 2, 2);
+    }
+    else
+    {
+        *--p = (char)('0' + value);
+    }
+
+    size_t length = end - p;
+    memcpy(buffer, p, length);
+    return length;
+}
+
+size_t formatInteger(char *buffer, int64_t value)
+{
+    if (value < 0)
+    {
+        *buffer = '-';
+        // 先转换为无符号数，INT64_MIN取反不会溢出
+        return 1 + formatUInteger(buffer + 1, 0 - (uint64_t)value);
+    }
+    return formatUInteger(buffer, (uint64_t)value);
+}
+
+size_t formatFloat(char *buffer, double value)
+{
+    return formatFloatImpl(buffer, value);
+}
+
+size_t formatFloat(char *buffer, float value)
+{
+    return formatFloatImpl(buffer, value);
+}
+
+NS_SMARTJSON_END
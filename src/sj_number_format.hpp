@@ -0,0 +1,32 @@
+﻿#pragma once
+#include "sj_config.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+NS_SMARTJSON_BEGIN
+
+/** 格式化数字时，缓冲区需要的最小长度 */
+const size_t MAX_NUMBER_LENGTH = 32;
+
+/**
+ *  将整数格式化为十进制字符串。从低位开始，每次查表输出两位数字。
+ *  不会写入'\0'，buffer的长度至少为MAX_NUMBER_LENGTH。
+ *  @return 写入的字符数。
+ */
+size_t formatInteger(char *buffer, int64_t value);
+size_t formatUInteger(char *buffer, uint64_t value);
+
+/**
+ *  将浮点数格式化为十进制字符串(Grisu2算法)，与locale无关。结果总能精确还原为原来的值，
+ *  绝大多数情况下也是最短的，极少数情况下会多出一两位数字。
+ *  指数在[-6, 21)范围内时使用小数形式，否则使用科学计数法，如1e+30写作1e30。
+ *  整数值会加上".0"，重新解析后仍然是浮点数。NaN和无穷大写作nan、inf和-inf。
+ *  float按单精度的精度计算，如0.1f写作0.1。
+ *  不会写入'\0'，buffer的长度至少为MAX_NUMBER_LENGTH。
+ *  @return 写入的字符数。
+ */
+size_t formatFloat(char *buffer, double value);
+size_t formatFloat(char *buffer, float value);
+
+NS_SMARTJSON_END
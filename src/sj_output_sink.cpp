@@ -0,0 +1,289 @@
+﻿#include "sj_output_sink.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <ostream>
+
+#ifdef _WIN32
+#   include <io.h>
+#   include <fcntl.h>
+#   include <sys/stat.h>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/uio.h>
+#endif
+
+NS_SMARTJSON_BEGIN
+
+//////////////////////////////////////////////////////////////////////
+// MemorySink
+//////////////////////////////////////////////////////////////////////
+
+MemorySink::MemorySink(size_t capacity)
+{
+    buffer_.resize(std::max<size_t>(capacity, 16));
+    reset(0);
+}
+
+void MemorySink::clear()
+{
+    if (buffer_.empty())
+    {
+        buffer_.resize(16);
+    }
+    reset(0);
+    failed_ = false;
+}
+
+void MemorySink::moveTo(std::string &output)
+{
+    buffer_.resize(size());
+    output.swap(buffer_);
+    buffer_.clear();
+    begin_ = cursor_ = end_ = nullptr;
+}
+
+void MemorySink::overflow(const char *data, size_t length)
+{
+    size_t used = size();
+    buffer_.resize(std::max(buffer_.size() * 2, used + length));
+    reset(used);
+
+    memcpy(cursor_, data, length);
+    cursor_ += length;
+}
+
+void MemorySink::reset(size_t used)
+{
+    begin_ = &buffer_[0];
+    cursor_ = begin_ + used;
+    end_ = begin_ + buffer_.size();
+}
+
+//////////////////////////////////////////////////////////////////////
+// FixedBufferSink
+//////////////////////////////////////////////////////////////////////
+
+FixedBufferSink::FixedBufferSink(char *buffer, size_t capacity)
+{
+    begin_ = cursor_ = buffer;
+    end_ = buffer + capacity;
+}
+
+void FixedBufferSink::clear()
+{
+    cursor_ = begin_;
+    failed_ = false;
+}
+
+void FixedBufferSink::overflow(const char *data, size_t length)
+{
+    // 写入放得下的部分，剩余的数据被丢弃
+    size_t n = std::min(length, (size_t)(end_ - cursor_));
+    memcpy(cursor_, data, n);
+    cursor_ += n;
+    failed_ = true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// FileSink
+//////////////////////////////////////////////////////////////////////
+
+FileSink::FileSink(size_t bufferSize)
+    : buffer_(std::max<size_t>(bufferSize, 16))
+{
+    begin_ = cursor_ = buffer_.data();
+    end_ = begin_ + buffer_.size();
+}
+
+FileSink::~FileSink()
+{
+    close();
+}
+
+bool FileSink::open(const char *fileName, bool binary)
+{
+    close();
+    failed_ = false;
+
+#ifdef _WIN32
+    int flags = _O_WRONLY | _O_CREAT | _O_TRUNC | (binary ? _O_BINARY : _O_TEXT);
+    fd_ = _open(fileName, flags, _S_IREAD | _S_IWRITE);
+#else
+    (void)binary;
+    fd_ = ::open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    ownFd_ = true;
+    return fd_ >= 0;
+}
+
+void FileSink::attach(int fd)
+{
+    close();
+    failed_ = false;
+    fd_ = fd;
+    ownFd_ = false;
+}
+
+bool FileSink::close()
+{
+    bool ret = flush();
+    if (fd_ >= 0 && ownFd_)
+    {
+#ifdef _WIN32
+        ret = _close(fd_) == 0 && ret;
+#else
+        ret = ::close(fd_) == 0 && ret;
+#endif
+    }
+    fd_ = -1;
+    ownFd_ = false;
+    return ret;
+}
+
+bool FileSink::flush()
+{
+    if (cursor_ != begin_)
+    {
+        if (fd_ < 0 || !writeFully(begin_, cursor_ - begin_))
+        {
+            failed_ = true;
+        }
+        cursor_ = begin_;
+    }
+    return !failed_;
+}
+
+void FileSink::overflow(const char *data, size_t length)
+{
+    if (length < buffer_.size())
+    {
+        // 小块数据先写出缓冲区，再拷贝到缓冲区中
+        flush();
+        memcpy(cursor_, data, length);
+        cursor_ += length;
+        return;
+    }
+
+    if (fd_ < 0)
+    {
+        failed_ = true;
+        cursor_ = begin_;
+        return;
+    }
+
+#ifdef _WIN32
+    bool ok = writeFully(begin_, cursor_ - begin_) && writeFully(data, length);
+#else
+    // 大块数据和缓冲区一起写出
+    size_t buffered = cursor_ - begin_;
+    struct iovec iov[2];
+    iov[0].iov_base = begin_;
+    iov[0].iov_len = buffered;
+    iov[1].iov_base = const_cast<char*>(data);
+    iov[1].iov_len = length;
+
+    ssize_t n;
+    do
+    {
+        n = ::writev(fd_, iov, 2);
+    } while (n < 0 && errno == EINTR);
+
+    bool ok = n >= 0;
+    if (ok)
+    {
+        // 没有全部写出时，继续写出剩下的部分
+        size_t written = (size_t)n;
+        if (written < buffered)
+        {
+            ok = writeFully(begin_ + written, buffered - written) && writeFully(data, length);
+        }
+        else
+        {
+            written -= buffered;
+            ok = writeFully(data + written, length - written);
+        }
+    }
+#endif
+
+    cursor_ = begin_;
+    if (!ok)
+    {
+        failed_ = true;
+    }
+}
+
+bool FileSink::writeFully(const char *data, size_t length)
+{
+    while (length > 0)
+    {
+#ifdef _WIN32
+        int n = _write(fd_, data, (unsigned)std::min<size_t>(length, 0x40000000));
+#else
+        ssize_t n = ::write(fd_, data, length);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+#endif
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        length -= (size_t)n;
+    }
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// StreamSink
+//////////////////////////////////////////////////////////////////////
+
+StreamSink::StreamSink(std::ostream &stream, size_t bufferSize)
+    : stream_(stream)
+    , buffer_(std::max<size_t>(bufferSize, 16))
+{
+    begin_ = cursor_ = buffer_.data();
+    end_ = begin_ + buffer_.size();
+}
+
+StreamSink::~StreamSink()
+{
+    flush();
+}
+
+bool StreamSink::flush()
+{
+    if (cursor_ != begin_)
+    {
+        stream_.write(begin_, cursor_ - begin_);
+        cursor_ = begin_;
+    }
+    if (!stream_.good())
+    {
+        failed_ = true;
+    }
+    return !failed_;
+}
+
+void StreamSink::overflow(const char *data, size_t length)
+{
+    flush();
+    if (length < buffer_.size())
+    {
+        memcpy(cursor_, data, length);
+        cursor_ += length;
+    }
+    else
+    {
+        stream_.write(data, length);
+        if (!stream_.good())
+        {
+            failed_ = true;
+        }
+    }
+}
+
+NS_SMARTJSON_END
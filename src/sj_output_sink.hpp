@@ -0,0 +1,160 @@
+﻿#pragma once
+#include "sj_config.hpp"
+
+#include <cstring>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  写入器的输出目标。
+ *  数据先拷贝到内部的缓冲区，缓冲区放不下时才调用虚函数overflow，由子类扩大缓冲区或者整块写出，
+ *  避免每个字符都经过std::ostream。
+ */
+class IOutputSink
+{
+    SJ_DISABLE_COPY_ASSIGN(IOutputSink);
+public:
+    IOutputSink() = default;
+    virtual ~IOutputSink() = default;
+
+    inline void write(const char *data, size_t length)
+    {
+        if ((size_t)(end_ - cursor_) >= length)
+        {
+            memcpy(cursor_, data, length);
+            cursor_ += length;
+        }
+        else
+        {
+            overflow(data, length);
+        }
+    }
+
+    inline void write(const char *str)
+    {
+        write(str, strlen(str));
+    }
+
+    inline void put(char ch)
+    {
+        if (cursor_ != end_)
+        {
+            *cursor_++ = ch;
+        }
+        else
+        {
+            overflow(&ch, 1);
+        }
+    }
+
+    /** 写出缓冲区中的数据 */
+    virtual bool flush() { return !failed_; }
+
+    /** 是否所有的写入都成功了 */
+    bool good() const { return !failed_; }
+
+protected:
+    /** 缓冲区放不下data时调用，子类需要处理全部的data，失败时设置failed_ */
+    virtual void overflow(const char *data, size_t length) = 0;
+
+    char*           begin_ = nullptr;
+    char*           cursor_ = nullptr;
+    char*           end_ = nullptr;
+    bool            failed_ = false;
+};
+
+/** 写入可增长的内存缓冲区 */
+class MemorySink : public IOutputSink
+{
+public:
+    explicit MemorySink(size_t capacity = 4096);
+
+    const char* data() const { return begin_; }
+    size_t size() const { return cursor_ - begin_; }
+
+    void clear();
+
+    std::string str() const { return std::string(begin_, cursor_); }
+
+    /** 把写入的数据移动到output中，避免拷贝。之后缓冲区为空 */
+    void moveTo(std::string &output);
+
+protected:
+    void overflow(const char *data, size_t length) override;
+
+private:
+    void reset(size_t used);
+
+    std::string     buffer_;
+};
+
+/** 写入调用者提供的固定大小的缓冲区，放不下时只写入能放下的部分，并标记为失败 */
+class FixedBufferSink : public IOutputSink
+{
+public:
+    FixedBufferSink(char *buffer, size_t capacity);
+
+    const char* data() const { return begin_; }
+    size_t size() const { return cursor_ - begin_; }
+
+    void clear();
+
+protected:
+    void overflow(const char *data, size_t length) override;
+};
+
+/**
+ *  写入文件描述符。数据在缓冲区中攒成大块后再调用write；
+ *  单次写入的数据超过缓冲区大小时，使用writev把缓冲区和数据一起写出，不再拷贝。
+ */
+class FileSink : public IOutputSink
+{
+public:
+    explicit FileSink(size_t bufferSize = 64 * 1024);
+    ~FileSink();
+
+    /** 创建或者清空文件。binary只影响Windows平台的换行符转换 */
+    bool open(const char *fileName, bool binary = true);
+
+    /** 写入已经打开的文件描述符，不负责关闭 */
+    void attach(int fd);
+
+    /** 写出缓冲区中的数据，并关闭open打开的文件 */
+    bool close();
+
+    bool isOpen() const { return fd_ >= 0; }
+
+    bool flush() override;
+
+protected:
+    void overflow(const char *data, size_t length) override;
+
+private:
+    bool writeFully(const char *data, size_t length);
+
+    int             fd_ = -1;
+    bool            ownFd_ = false;
+    std::vector<char> buffer_;
+};
+
+/** 写入std::ostream，用于兼容以前的接口。数据攒成大块后再写入 */
+class StreamSink : public IOutputSink
+{
+public:
+    explicit StreamSink(std::ostream &stream, size_t bufferSize = 16 * 1024);
+    ~StreamSink();
+
+    bool flush() override;
+
+protected:
+    void overflow(const char *data, size_t length) override;
+
+private:
+    std::ostream&   stream_;
+    std::vector<char> buffer_;
+};
+
+NS_SMARTJSON_END
@@ -0,0 +1,229 @@
+﻿#include "sj_parallel_parser.hpp"
+#include "sj_structural_index.hpp"
+
+#include <vector>
+
+NS_SMARTJSON_BEGIN
+
+namespace
+{
+    /**
+     *  解析根容器中的一段元素，不包含两端的括号和分隔用的','。
+     *  数组的元素依次保存在根节点中；字典的key和value交替保存，由调用者按顺序合并，
+     *  这样重复的key的处理方式与顺序解析相同。
+     */
+    class ChunkParser : public Parser
+    {
+    public:
+        ChunkParser(IAllocator *allocator, bool isDict)
+            : Parser(allocator)
+            , isDict_(isDict)
+        {}
+
+    protected:
+        bool doParse() override
+        {
+            nextToken_ = 0;
+
+            if (presize_)
+            {
+                // 段内没有外层的括号，顶层的','不会被统计，只统计段内的容器
+                countElements();
+            }
+
+            root_.setArray(allocator_);
+            while (true)
+            {
+                Node value;
+                if (!parseValue(value))
+                {
+                    return false;
+                }
+
+                if (isDict_)
+                {
+                    if (!value.isString() && !value.isInt())
+                    {
+                        return onError(RC_INVALID_KEY);
+                    }
+                    root_.pushBack(value);
+
+                    if (nextToken() != ':' || !parseValue(value))
+                    {
+                        return onError(RC_INVALID_DICT);
+                    }
+                }
+                root_.pushBack(value);
+
+                int ch = nextToken();
+                if (ch == 0)
+                {
+                    return true;
+                }
+                if (ch != ',')
+                {
+                    return onError(isDict_ ? RC_INVALID_DICT : RC_INVALID_ARRAY);
+                }
+            }
+        }
+
+    private:
+        bool isDict_;
+    };
+
+    struct Chunk
+    {
+        Node    nodes;
+        bool    ok = false;
+    };
+
+    inline bool isSpace(char ch)
+    {
+        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+    }
+}
+
+ParallelParser::ParallelParser(size_t threadCount, IAllocator *allocator)
+    : Parser(allocator)
+    , pool_(threadCount)
+{
+}
+
+bool ParallelParser::doParse()
+{
+    isParallel_ = false;
+    if (pool_.size() > 1 &&
+        (size_t)(end_ - begin_) >= minParallelSize_ &&
+        handler_ == nullptr &&
+        pathFilter_.empty() &&
+        source_ == nullptr &&
+        !jsonLines_ &&
+        maxDepth_ > 0 &&
+        parseParallel())
+    {
+        isParallel_ = true;
+        return true;
+    }
+
+    root_ = Node();
+    errorCode_ = RC_OK;
+    return Parser::doParse();
+}
+
+bool ParallelParser::parseParallel()
+{
+    const char *first = begin_;
+    while (first != end_ && isSpace(*first))
+    {
+        ++first;
+    }
+    const char *last = end_;
+    while (last != first && isSpace(last[-1]))
+    {
+        --last;
+    }
+    if (last - first < 2 ||
+        !((*first == '[' && last[-1] == ']') || (*first == '{' && last[-1] == '}')))
+    {
+        return false;
+    }
+    bool isDict = *first == '{';
+
+    size_t chunkSize = (size_t)(end_ - begin_) / (pool_.size() * 4);
+    if (chunkSize < minChunkSize_)
+    {
+        chunkSize = minChunkSize_;
+    }
+
+    std::vector<size_t> splits;
+    if (!StructuralIndex::findSplitPoints(begin_, end_ - begin_, chunkSize, splits) || splits.empty())
+    {
+        return false;
+    }
+
+    std::vector<std::future<Chunk>> futures;
+    futures.reserve(splits.size() + 1);
+
+    const char *chunkBegin = first + 1;
+    for (size_t i = 0; i <= splits.size(); ++i)
+    {
+        const char *chunkEnd = i < splits.size() ? begin_ + splits[i] : last - 1;
+        futures.push_back(pool_.submit([this, chunkBegin, chunkEnd, isDict]()
+        {
+            IAllocator *allocator = allocatorFactory_ ? allocatorFactory_() : new IAllocator();
+
+            ChunkParser parser(allocator, isDict);
+            // 根容器占用了一层嵌套
+            parser.maxDepth_ = maxDepth_ - 1;
+            parser.presize_ = presize_;
+            parser.validateUTF8_ = validateUTF8_;
+            Chunk chunk;
+            chunk.ok = parser.parse(chunkBegin, chunkEnd - chunkBegin);
+            if (chunk.ok)
+            {
+                chunk.nodes = parser.getRoot();
+            }
+            return chunk;
+        }));
+        chunkBegin = chunkEnd + 1;
+    }
+
+    // 等待所有任务完成，节点只能在任务结束后由当前线程访问
+    std::vector<Chunk> chunks;
+    chunks.reserve(futures.size());
+    for (auto &future : futures)
+    {
+        chunks.push_back(future.get());
+    }
+
+    for (const Chunk &chunk : chunks)
+    {
+        if (!chunk.ok)
+        {
+            return false;
+        }
+    }
+
+    if (isDict)
+    {
+        Dict *dict = root_.setDict(allocator_);
+        if (presize_)
+        {
+            size_t size = 0;
+            for (const Chunk &chunk : chunks)
+            {
+                size += chunk.nodes.size() / 2;
+            }
+            dict->reserve(size);
+        }
+        for (Chunk &chunk : chunks)
+        {
+            Array &nodes = chunk.nodes.refArray();
+            for (size_t i = 0; i + 1 < nodes.size(); i += 2)
+            {
+                root_.emplaceMember(std::move(nodes[i]), std::move(nodes[i + 1]));
+            }
+        }
+    }
+    else
+    {
+        size_t size = 0;
+        for (const Chunk &chunk : chunks)
+        {
+            size += chunk.nodes.size();
+        }
+
+        root_.setArray(allocator_);
+        root_.reserve(size);
+        for (const Chunk &chunk : chunks)
+        {
+            for (const Node &node : chunk.nodes.refArray())
+            {
+                root_.pushBack(node);
+            }
+        }
+    }
+    return true;
+}
+
+NS_SMARTJSON_END
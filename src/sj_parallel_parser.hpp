@@ -0,0 +1,51 @@
+﻿#pragma once
+#include "sj_parser.hpp"
+#include "sj_thread_pool.hpp"
+
+#include <functional>
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  并行解析单个大文件。根节点是数组或字典时，先用结构字符索引快速扫描一遍，
+ *  在根容器的','处把元素切分成若干段，由线程池并行解析，最后按原始顺序合并到根节点中。
+ *  每段使用独立的分配器，解析线程之间不会竞争同一个分配器。
+ *
+ *  以下情况会退化为顺序解析，结果与Parser完全相同：
+ *  输入数据小于minParallelSize_、线程池只有一个线程、设置了handler、路径过滤器、jsonLines_或原地解析、
+ *  字符串外出现了注释、以及任意一段解析失败(重新顺序解析，以得到准确的错误位置)。
+ */
+class ParallelParser : public Parser
+{
+    SJ_DISABLE_COPY_ASSIGN(ParallelParser);
+public:
+    /** 创建每段数据使用的分配器。会在解析线程中调用，需要是线程安全的 */
+    typedef std::function<IAllocator*()> AllocatorFactory;
+
+    /** threadCount为0时，使用硬件支持的并发线程数。allocator只用于创建根节点 */
+    explicit ParallelParser(size_t threadCount = 0, IAllocator *allocator = nullptr);
+
+    /** 上一次解析是否使用了并行解析 */
+    bool isParallel() const { return isParallel_; }
+
+protected:
+    bool doParse() override;
+
+public:
+    /** 小于此字节数的输入直接顺序解析 */
+    size_t          minParallelSize_ = 1024 * 1024;
+
+    /** 每段数据的最小字节数 */
+    size_t          minChunkSize_ = 256 * 1024;
+
+    /** 为空时，每段数据使用一个新的IAllocator */
+    AllocatorFactory allocatorFactory_;
+
+private:
+    bool parseParallel();
+
+    ThreadPool      pool_;
+    bool            isParallel_ = false;
+};
+
+NS_SMARTJSON_END
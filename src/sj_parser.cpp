@@ -1,9 +1,15 @@
 ﻿#include "sj_parser.hpp"
-
-#include <cmath>
+#include "sj_mapped_file.hpp"
+#include "sj_number_format.hpp"
+#include "sj_source_buffer.hpp"
+#include "sj_string_scan.hpp"
+#include "sj_utf8.hpp"
+#include "sj_utils.hpp"
+
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
-#include <fstream>
 
 NS_SMARTJSON_BEGIN
 
@@ -24,43 +30,75 @@ IParser::~IParser()
 
 bool IParser::parseFromFile(const char *fileName)
 {
-    int mode = isBinaryFile_ ? std::ifstream::binary : 0;
+    if (inSitu_)
+    {
+        SourceBuffer *buffer = SourceBuffer::createFromFile(fileName);
+        if (buffer == nullptr)
+        {
+            return onError(RC_OPEN_FILE_ERROR);
+        }
+        return parse(buffer);
+    }
 
-    std::ifstream stream(fileName, mode);
-    if (!stream.is_open())
+    MappedFile file;
+    if (!file.open(fileName))
     {
         return onError(RC_OPEN_FILE_ERROR);
     }
-    return parse(stream);
-}
-
-bool IParser::parseFromFile(const std::string & fileName)
+    return parse(file.data(), file.size());
+}
+
+bool IParser::parseFromFile(const std::string & fileName)
 {
     return parseFromFile(fileName.c_str());
 }
 
 bool IParser::parseFromData(const char *str, size_t length)
 {
-    std::istringstream ss(std::string(str, length));
-    return parse(ss);
-}
-
-bool IParser::parseFromString(const std::string &str)
-{
-    std::istringstream ss(str);
-    return parse(ss);
-}
-
-bool IParser::parse(std::istream & stream)
-{
-    stream_ = &stream;
+    if (inSitu_)
+    {
+        return parse(SourceBuffer::createFromData(str, length));
+    }
+    return parse(str, length);
+}
+
+bool IParser::parseFromString(const std::string &str)
+{
+    return parseFromData(str.data(), str.size());
+}
+
+bool IParser::parse(std::istream & stream)
+{
+    std::ostringstream ss;
+    ss << stream.rdbuf();
+    std::string data = ss.str();
+    return parseFromData(data.data(), data.size());
+}
+
+bool IParser::parse(SourceBuffer *buffer)
+{
+    buffer->retain();
+    source_ = buffer;
+
+    bool ret = parse(buffer->data(), buffer->size());
+
+    source_ = nullptr;
+    buffer->release();
+    return ret;
+}
+
+bool IParser::parse(const char *data, size_t length)
+{
+    begin_ = data;
+    cursor_ = data;
+    end_ = data + length;
     root_.setNull();
-    errorCode_ = RC_OK;
-
-    bool ret = doParse();
-
-    stream_ = nullptr;
-    return ret && errorCode_ == RC_OK;
+    errorCode_ = RC_OK;
+
+    bool ret = doParse();
+
+    begin_ = cursor_ = end_ = nullptr;
+    return ret && errorCode_ == RC_OK;
 }
 
 bool IParser::onError(int code)
@@ -72,66 +110,191 @@ bool IParser::onError(int code)
 //////////////////////////////////////////////////////////////////////
 // IWriter
 //////////////////////////////////////////////////////////////////////
-
-bool IWriter::writeToFile(const Node &node, const char * fileName)
-{
-    int mode = isBinaryFile_ ? std::ofstream::binary : 0;
 
-    std::ofstream stream(fileName, mode);
-    if (!stream.is_open())
+bool IWriter::writeToFile(const Node &node, const char * fileName)
+{
+    FileSink sink;
+    if (!sink.open(fileName, isBinaryFile_))
     {
         return onError(RC_OPEN_FILE_ERROR);
-    }
-    return write(node, stream);
-}
-
-bool IWriter::writeToFile(const Node &node, const std::string & fileName)
-{
-    return writeToFile(node, fileName.c_str());
-}
-
-bool IWriter::write(const Node & node, std::ostream & out)
-{
-    stream_ = &out;
-    errorCode_ = RC_OK;
-
-    onWrite(node);
-
-    stream_ = nullptr;
-    return errorCode_ == RC_OK;
-}
-
-std::string IWriter::toString(const Node & node)
-{
-    std::ostringstream ss;
-    write(node, ss);
-    return errorCode_ == RC_OK ? ss.str() : "";
-}
-
-bool IWriter::onError(int code)
-{
-    errorCode_ = code;
-    return false;
-}
+    }
+
+    bool ret = write(node, sink);
+    if (!sink.close() && ret)
+    {
+        return onError(RC_WRITE_ERROR);
+    }
+    return ret;
+}
+
+bool IWriter::writeToFile(const Node &node, const std::string & fileName)
+{
+    return writeToFile(node, fileName.c_str());
+}
+
+bool IWriter::write(const Node & node, IOutputSink & out)
+{
+    sink_ = &out;
+    errorCode_ = RC_OK;
+
+    onWrite(node);
+
+    sink_ = nullptr;
+    if (!out.flush() && errorCode_ == RC_OK)
+    {
+        return onError(RC_WRITE_ERROR);
+    }
+    return errorCode_ == RC_OK;
+}
+
+bool IWriter::write(const Node & node, std::ostream & out)
+{
+    StreamSink sink(out);
+    return write(node, sink);
+}
+
+std::string IWriter::toString(const Node & node)
+{
+    MemorySink sink;
+    std::string ret;
+    if (write(node, sink))
+    {
+        sink.moveTo(ret);
+    }
+    return ret;
+}
+
+bool IWriter::onError(int code)
+{
+    errorCode_ = code;
+    return false;
+}
 
 
 //////////////////////////////////////////////////////////////////////
 // Json Parser
 //////////////////////////////////////////////////////////////////////
 
-Parser::Parser(IAllocator *allocator)
+template<typename Policy>
+BasicParser<Policy>::BasicParser(IAllocator *allocator)
     : IParser(allocator)
 {
 }
 
-bool Parser::doParse()
+template<typename Policy>
+int BasicParser<Policy>::getLine() const
+{
+    if (errorCode_ != RC_OK || begin_ == nullptr)
+    {
+        return line_;
+    }
+    int line, column;
+    locate(cursor_, line, column);
+    return line;
+}
+
+template<typename Policy>
+int BasicParser<Policy>::getColumn() const
+{
+    if (errorCode_ != RC_OK || begin_ == nullptr)
+    {
+        return column_;
+    }
+    int line, column;
+    locate(cursor_, line, column);
+    return column;
+}
+
+template<typename Policy>
+bool BasicParser<Policy>::onError(int code)
+{
+    // 解析结束后输入数据可能会被释放，出错时立即计算行号和列号
+    if (begin_ != nullptr)
+    {
+        errorOffset_ = (size_t)(cursor_ - begin_);
+        locate(cursor_, line_, column_);
+    }
+    return IParser::onError(code);
+}
+
+template<typename Policy>
+void BasicParser<Policy>::locate(const char *position, int &line, int &column) const
+{
+    line = 1;
+    const char *lineBegin = begin_;
+    const char *p = begin_;
+    while ((p = (const char*)memchr(p, '\n', position - p)) != nullptr)
+    {
+        ++line;
+        lineBegin = ++p;
+    }
+    column = (int)(position - lineBegin) + 1;
+}
+
+template<typename Policy>
+bool BasicParser<Policy>::doParse()
 {
     line_ = 1;
     column_ = 1;
+    errorOffset_ = 0;
     nextToken_ = 0;
+    depth_ = 0;
+
+    elementCounts_.clear();
+    containerIndex_ = 0;
+    if (presize_ && handler_ == nullptr && pathFilter_.empty())
+    {
+        countElements();
+    }
+
+    reuse_ = nullptr;
+    reuseSlots_.clear();
+    if (target_ != nullptr && handler_ == nullptr && pathFilter_.empty() && !jsonLines_)
+    {
+        // 先校验格式，出错时不会修改existing
+        int ch = aheadToken();
+        if (ch == '{' || ch == '[')
+        {
+            if (!skipValue())
+            {
+                return false;
+            }
+            if (aheadToken() != 0)
+            {
+                return onError(RC_INVALID_JSON);
+            }
+            cursor_ = begin_;
+            nextToken_ = 0;
+            depth_ = 0;
+            reuse_ = target_;
+        }
+    }
+
+    if (jsonLines_)
+    {
+        return parseLines();
+    }
 
     int firstChar = nextToken();
-    if (firstChar == '{')
+    if (handler_ == nullptr && !pathFilter_.empty() && (firstChar == '{' || firstChar == '['))
+    {
+        if (firstChar == '{')
+        {
+            parseFilteredDict(root_, 0);
+        }
+        else
+        {
+            root_.setArray(allocator_);
+            nextToken_ = firstChar;
+            skipValue();
+        }
+    }
+    else if (handler_ != nullptr && (firstChar == '{' || firstChar == '['))
+    {
+        nextToken_ = firstChar;
+        emitValue();
+    }
+    else if (firstChar == '{')
     {
         parseDict(root_);
     }
@@ -166,52 +329,91 @@ bool Parser::doParse()
     return errorCode_ == RC_OK;
 }
 
-char Parser::getChar()
+template<typename Policy>
+bool BasicParser<Policy>::parseLines()
 {
-    char ch = stream_->get();
-    switch (ch)
+    if (handler_ == nullptr)
     {
-    case '\n':
-        ++line_;
-        column_ = 1;
-        return ch;
-    case EOF:
-    case '\0':
-        return 0;
-    default:
-        ++column_;
-        return ch;
+        root_.setArray(allocator_);
     }
-}
 
-void Parser::ungetChar(char ch)
-{
-    stream_->unget();
-    --column_;
-    if (ch == '\n')
+    while (errorCode_ == RC_OK)
     {
-        --line_;
+        int ch = aheadToken();
+        if (ch == 0)
+        {
+            break;
+        }
+
+        // 值和注释都不能跨越多行：解析期间把输入限制在当前行内，与JsonLinesParser按行切分的结果相同
+        const char *end = end_;
+        const char *lineEnd = (const char*)memchr(cursor_, '\n', end_ - cursor_);
+        if (lineEnd != nullptr)
+        {
+            end_ = lineEnd;
+        }
+
+        bool ok;
+        if (ch == '/')
+        {
+            nextToken();
+            ok = parseComment();
+        }
+        else if (handler_ != nullptr)
+        {
+            ok = emitValue();
+        }
+        else
+        {
+            Node value;
+            ok = parseValue(value);
+            if (ok)
+            {
+                root_.pushBack(value);
+            }
+        }
+        end_ = end;
+
+        if (!ok)
+        {
+            if (errorCode_ == RC_END_OF_FILE && lineEnd != nullptr)
+            {
+                // 不是真正的文件结束，而是值在行尾处被截断
+                errorCode_ = RC_INVALID_JSON;
+            }
+            break;
+        }
+        if (ch == '/')
+        {
+            continue;
+        }
+
+        // 每行只能有一个值
+        while (cursor_ != end_ && (*cursor_ == ' ' || *cursor_ == '\t' || *cursor_ == '\r'))
+        {
+            ++cursor_;
+        }
+        if (cursor_ != end_ && *cursor_ != '\n')
+        {
+            onError(RC_INVALID_JSON);
+        }
     }
+    return errorCode_ == RC_OK;
 }
 
-char Parser::translateChar(char ch)
+template<typename Policy>
+inline char BasicParser<Policy>::getChar()
 {
-    switch (ch)
+    if (cursor_ == end_)
     {
-    case 'b': return '\b';
-    case 'f': return '\f';
-    case 'n': return '\n';
-    case 't': return '\t';
-    case 'r': return '\r';
-    case '"': return '"';
-    case '\\': return '\\';
-    case '/': return '/';
-    default:
-        return ch;
+        return 0;
     }
+
+    return *cursor_++;
 }
 
-int Parser::parseToken()
+template<typename Policy>
+int BasicParser<Policy>::parseToken()
 {
     char ch;
     do
@@ -221,7 +423,8 @@ int Parser::parseToken()
     return ch;
 }
 
-int Parser::nextToken()
+template<typename Policy>
+int BasicParser<Policy>::nextToken()
 {
     if (nextToken_ != 0)
     {
@@ -235,7 +438,8 @@ int Parser::nextToken()
     }
 }
 
-int Parser::aheadToken()
+template<typename Policy>
+int BasicParser<Policy>::aheadToken()
 {
     if (nextToken_ == 0)
     {
@@ -244,7 +448,22 @@ int Parser::aheadToken()
     return nextToken_;
 }
 
-bool Parser::parseValue(Node &node)
+template<typename Policy>
+bool BasicParser<Policy>::parseValue(Node &node)
+{
+    int ret = parseScalar(node);
+    if (ret == '{' || ret == '[')
+    {
+        return parseContainer(node, ret);
+    }
+    return ret != 0;
+}
+
+/** 解析一个标量，成功返回1，出错返回0。
+ *  遇到'{'或'['时不会继续解析，直接返回起始符，由调用者处理。
+ */
+template<typename Policy>
+int BasicParser<Policy>::parseScalar(Node &node)
 {
     while (errorCode_ == RC_OK)
     {
@@ -252,396 +471,1145 @@ bool Parser::parseValue(Node &node)
         switch (ch)
         {
             case '\0':
-                return onError(RC_END_OF_FILE);
+                onError(RC_END_OF_FILE);
+                return 0;
                 
             case '{':
-                return parseDict(node);
-                
             case '[':
-                return parseArray(node);
+                return ch;
                 
             case '"':
-                return parseString(node);
+                return parseString(node) ? 1 : 0;
 
             case 'n':
-                return parseNull(node);
+                return parseNull(node) ? 1 : 0;
                 
             case 't':
-                return parseTrue(node);
+                return parseTrue(node) ? 1 : 0;
                 
             case 'f':
-                return parseFalse(node);
+                return parseFalse(node) ? 1 : 0;
                 
             case '/':
                 parseComment();
                 break;
                 
             default:
-                return parseNumber(node, ch);
+                return parseNumber(node) ? 1 : 0;
         }
     }
-    return false;
+    return 0;
 }
 
-bool Parser::parseDict(Node &node)
+template<typename Policy>
+bool BasicParser<Policy>::parseDict(Node &node)
 {
-    node.setDict(allocator_);
-    
-    char ch = aheadToken();
-    if (ch == '}')
-    {
-        nextToken();
-        return true;
-    }
-    if (ch == 0)
-    {
-        return onError(RC_INVALID_DICT);
-    }
+    return parseContainer(node, '{');
+}
+
+template<typename Policy>
+bool BasicParser<Policy>::parseArray(Node &node)
+{
+    return parseContainer(node, '[');
+}
 
+/** 非递归地解析数组或字典，open是已经读取的起始符。
+ *  未完成的容器保存在frames_中，而不是函数调用栈上，嵌套深度受maxDepth_限制。
+ *  reuse_不为空时，它是这个容器在已有树中的对应节点，容器会尽量复用它(见parseInto)。
+ */
+template<typename Policy>
+bool BasicParser<Policy>::parseContainer(Node &node, int open)
+{
+    // parseValue可能在解析过程中被重入(如路径过滤)，只使用base之上的部分
+    const size_t base = frames_.size();
+    const size_t slotBase = reuseSlots_.size();
+    Node *reuse = reuse_;
+    reuse_ = nullptr;
+    Node value;
+    int ch = open;
     while (true)
     {
-        Node key, value;
-        if (!parseValue(key))
+        // ch是刚读取的容器起始符，为0时value是一个已经完成的值
+        bool complete = (ch == 0);
+        if (!complete)
         {
-            return false;
+            if (frames_.size() - base >= maxDepth_)
+            {
+                onError(RC_TOO_DEEP);
+                break;
+            }
+
+            size_t count = 0;
+            if (containerIndex_ < elementCounts_.size())
+            {
+                count = elementCounts_[containerIndex_++];
+            }
+
+            frames_.emplace_back();
+            Frame &frame = frames_.back();
+            int next = aheadToken();
+            if (reuse != nullptr && reuse->isUnique() && (ch == '{' ? reuse->isDict() : reuse->isArray()))
+            {
+                // 只复用没有被其他节点引用的容器，原有的元素在解析过程中被逐个覆盖
+                frame.node = *reuse;
+                frame.reused = true;
+                frame.oldSize = frame.node.size();
+                frame.slotBase = reuseSlots_.size();
+            }
+            else if (ch == '{')
+            {
+                Dict *dict = frame.node.setDict(allocator_);
+                if (count > 0)
+                {
+                    dict->reserve(count);
+                }
+            }
+            else
+            {
+                Array *array = frame.node.setArray(allocator_);
+                if (count > 0)
+                {
+                    array->reserve(count);
+                }
+            }
+            reuse = nullptr;
+
+            if (ch == '{' && next == 0)
+            {
+                onError(RC_INVALID_DICT);
+                break;
+            }
+
+            if (next == (ch == '{' ? '}' : ']'))
+            {
+                nextToken();
+                if (frame.reused)
+                {
+                    frame.node.clear();
+                }
+                value = std::move(frame.node);
+                frames_.pop_back();
+                complete = true;
+            }
         }
-    
-        if(!key.isString() && !key.isInt())
+
+        if (complete)
         {
-            return onError(RC_INVALID_KEY);
+            if (frames_.size() == base)
+            {
+                node = std::move(value);
+                return true;
+            }
+
+            Frame &frame = frames_.back();
+            bool isDict = frame.node.isDict();
+            if (frame.slot != nullptr)
+            {
+                *frame.slot = std::move(value);
+                frame.slot = nullptr;
+            }
+            else if (isDict)
+            {
+                frame.node.emplaceMember(std::move(frame.key), std::move(value));
+            }
+            else
+            {
+                frame.node.refArray().push_back(std::move(value));
+            }
+
+            int next = nextToken();
+            if (next == (isDict ? '}' : ']'))
+            {
+                if (frame.reused)
+                {
+                    finishReused(frame);
+                }
+                value = std::move(frame.node);
+                frames_.pop_back();
+                ch = 0;
+                continue;
+            }
+            if (next != ',')
+            {
+                onError(isDict ? RC_INVALID_DICT : RC_INVALID_ARRAY);
+                break;
+            }
         }
-        
-        int ch = nextToken();
-        if(ch != ':')
+
+        // 读取栈顶容器的下一个元素，字典需要先读取key和':'
+        Frame &frame = frames_.back();
+        if (frame.node.isDict())
         {
-            return onError(RC_INVALID_DICT);
+            if (frame.reused)
+            {
+                if (!parseReusedKey(frame))
+                {
+                    break;
+                }
+            }
+            else
+            {
+                int ret = parseScalar(frame.key);
+                if (ret == 0)
+                {
+                    break;
+                }
+                if (ret != 1 || !(frame.key.isString() || (Policy::integerKeys && frame.key.isInt())))
+                {
+                    onError(RC_INVALID_KEY);
+                    break;
+                }
+            }
+            if (nextToken() != ':')
+            {
+                onError(RC_INVALID_DICT);
+                break;
+            }
         }
-        
-        if(!parseValue(value))
+        else if (frame.reused)
         {
-            return false;
+            if (frame.index < frame.oldSize)
+            {
+                frame.slot = &frame.node.refArray()[frame.index];
+            }
+            ++frame.index;
         }
-    
-        node.setMember(key, value);
-        
-        ch = nextToken();
-        if (ch == '}')
+
+        // 复用时，新的值以原来的值为模板
+        reuse_ = frame.slot;
+        int ret = parseScalar(value);
+        reuse_ = nullptr;
+        if (ret == 0)
         {
-            return true;
+            break;
+        }
+        ch = (ret == 1) ? 0 : ret;
+        reuse = frame.slot;
+    }
+
+    // 出错时释放未完成的容器
+    frames_.resize(base);
+    reuseSlots_.resize(slotBase);
+    return false;
+}
+
+/** 读取复用字典的key，已有的key直接使用字典中的节点，并记录值的位置 */
+template<typename Policy>
+bool BasicParser<Policy>::parseReusedKey(Frame &frame)
+{
+    int ch = nextToken();
+    while (ch == '/' && parseComment())
+    {
+        ch = nextToken();
+    }
+    if (errorCode_ != RC_OK)
+    {
+        return false;
+    }
+
+    Dict &dict = frame.node.refDict();
+    Dict::iterator it;
+    if (ch == '"')
+    {
+        const char *str;
+        size_t length;
+        if (!scanString(str, length))
+        {
+            return false;
+        }
+        it = dict.find(Node(allocator_->createString(str, length, BT_NOT_CARE)));
+        if (it == dict.end())
+        {
+            if (source_ != nullptr && length != 0)
+            {
+                frame.key = allocator_->createSharedString(str, length, source_);
+            }
+            else
+            {
+                frame.key = allocator_->createString(str, length, BT_MAKE_COPY);
+            }
+        }
+    }
+    else
+    {
+        nextToken_ = ch;
+        if (parseScalar(frame.key) != 1 || !(frame.key.isString() || (Policy::integerKeys && frame.key.isInt())))
+        {
+            return errorCode_ != RC_OK ? false : onError(RC_INVALID_KEY);
+        }
+        it = dict.find(frame.key);
+    }
+
+    if (it != dict.end())
+    {
+        frame.slot = &it->second;
+    }
+    else
+    {
+        frame.slot = &dict[std::move(frame.key)];
+    }
+    reuseSlots_.push_back(frame.slot);
+    return true;
+}
+
+/** 复用的容器解析完成后，删除新数据中已经不存在的元素 */
+template<typename Policy>
+void BasicParser<Policy>::finishReused(Frame &frame)
+{
+    if (frame.node.isArray())
+    {
+        Array &array = frame.node.refArray();
+        if (frame.index < array.size())
+        {
+            array.erase(array.begin() + frame.index, array.end());
+        }
+        return;
+    }
+
+    // 每个key都记录了值的位置。没有重复的key，并且记录数与字典大小相同时，所有原有的元素都被覆盖了
+    Dict &dict = frame.node.refDict();
+    std::vector<Node*>::iterator begin = reuseSlots_.begin() + frame.slotBase;
+    std::sort(begin, reuseSlots_.end());
+    std::vector<Node*>::iterator end = std::unique(begin, reuseSlots_.end());
+    if ((size_t)(end - begin) != dict.size())
+    {
+        for (Dict::iterator it = dict.begin(); it != dict.end();)
+        {
+            if (std::binary_search(begin, end, &it->second))
+            {
+                ++it;
+            }
+            else
+            {
+                it = dict.erase(it);
+            }
+        }
+    }
+    reuseSlots_.resize(frame.slotBase);
+}
+
+template<typename Policy>
+void BasicParser<Policy>::setPathFilter(const std::vector<std::string> &paths)
+{
+    pathFilter_.clear();
+    if (paths.empty())
+    {
+        return;
+    }
+
+    pathFilter_.push_back(PathNode{ std::string(), -1, false });
+    for (const std::string &path : paths)
+    {
+        int node = 0;
+        const char *begin = path.c_str();
+        const char *end = begin + path.size();
+        while (true)
+        {
+            const char *pos = std::find(begin, end, '/');
+            int child = findPathNode(node, begin, pos - begin);
+            if (child < 0)
+            {
+                child = (int)pathFilter_.size();
+                pathFilter_.push_back(PathNode{ std::string(begin, pos), node, false });
+            }
+            node = child;
+
+            if (pos == end)
+            {
+                break;
+            }
+            begin = pos + 1; // skip '/'
+        }
+        pathFilter_[node].leaf = true;
+    }
+}
+
+template<typename Policy>
+bool BasicParser<Policy>::parseInto(Node &existing, const char *data, size_t length)
+{
+    target_ = &existing;
+    bool ret = parseFromData(data, length);
+    target_ = nullptr;
+
+    if (ret && handler_ == nullptr)
+    {
+        existing = root_;
+    }
+    return ret;
+}
+
+template<typename Policy>
+bool BasicParser<Policy>::parseInto(Node &existing, const std::string &str)
+{
+    return parseInto(existing, str.data(), str.size());
+}
+
+template<typename Policy>
+int BasicParser<Policy>::findPathNode(int parent, const char *name, size_t length) const
+{
+    // 子节点总是在父节点之后创建
+    for (size_t i = parent + 1; i < pathFilter_.size(); ++i)
+    {
+        const PathNode &node = pathFilter_[i];
+        if (node.parent == parent && node.name.size() == length && memcmp(node.name.data(), name, length) == 0)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+template<typename Policy>
+bool BasicParser<Policy>::parseFilteredDict(Node &node, int filter)
+{
+    node.setDict(allocator_);
+
+    char ch = aheadToken();
+    if (ch == '}')
+    {
+        nextToken();
+        return true;
+    }
+    if (ch == 0)
+    {
+        return onError(RC_INVALID_DICT);
+    }
+
+    while (true)
+    {
+        // 与emitKey相同，只有字符串key需要匹配路径，整数key总是被跳过
+        int child = -1;
+        Node key;
+        while (errorCode_ == RC_OK)
+        {
+            ch = nextToken();
+            if (ch == '/')
+            {
+                parseComment();
+                continue;
+            }
+
+            if (ch == '"')
+            {
+                const char *str;
+                size_t length;
+                if (scanString(str, length))
+                {
+                    child = findPathNode(filter, str, length);
+                    if (child >= 0)
+                    {
+                        key = allocator_->createString(str, length, BT_MAKE_COPY);
+                    }
+                }
+            }
+            else if (Policy::integerKeys && (ch == '-' || ch == '+' || (ch >= '0' && ch <= '9')))
+            {
+                NumberResult result;
+                if (scanNumber(result) && !isInteger(result))
+                {
+                    onError(RC_INVALID_KEY);
+                }
+            }
+            else
+            {
+                onError(ch == 0 ? RC_END_OF_FILE : RC_INVALID_KEY);
+            }
+            break;
+        }
+        if (errorCode_ != RC_OK)
+        {
+            return false;
+        }
+
+        if (nextToken() != ':')
+        {
+            return onError(RC_INVALID_DICT);
+        }
+
+        if (child < 0)
+        {
+            if (!skipValue())
+            {
+                return false;
+            }
+        }
+        else
+        {
+            Node value;
+            if (pathFilter_[child].leaf)
+            {
+                if (!parseValue(value))
+                {
+                    return false;
+                }
+                node.emplaceMember(std::move(key), std::move(value));
+            }
+            else
+            {
+                while (aheadToken() == '/')
+                {
+                    nextToken();
+                    parseComment();
+                }
+
+                if (aheadToken() == '{')
+                {
+                    nextToken();
+                    if (!parseFilteredDict(value, child))
+                    {
+                        return false;
+                    }
+                    node.emplaceMember(std::move(key), std::move(value));
+                }
+                else
+                {
+                    // 路径上的值不是字典，不可能包含需要的节点
+                    if (!skipValue())
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        ch = nextToken();
+        if (ch == '}')
+        {
+            return true;
+        }
+        else if (ch != ',')
+        {
+            return onError(RC_INVALID_DICT);
+        }
+    }
+    return false;
+}
+
+template<typename Policy>
+bool BasicParser<Policy>::skipValue()
+{
+    // 复用事件驱动的解析流程，默认的处理器什么也不做
+    static IHandler s_skipper;
+
+    IHandler *handler = handler_;
+    handler_ = &s_skipper;
+    bool ret = emitValue();
+    handler_ = handler;
+    return ret;
+}
+
+/** 统计结果只用于预先分配内存，输入数据有错误时可能不准确，错误由解析过程报告 */
+template<typename Policy>
+void BasicParser<Policy>::countElements()
+{
+    std::vector<size_t> stack;
+    // 刚读取了容器的起始符，下一个有效字符决定容器是否为空
+    bool first = false;
+    const char *p = begin_;
+    while (p != end_)
+    {
+        char ch = *p++;
+        switch (ch)
+        {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+            continue;
+
+        case '/':
+            if (Policy::comments && p != end_ && *p == '/')
+            {
+                p = (const char*)memchr(p, '\n', end_ - p);
+                p = p != nullptr ? p : end_;
+                continue;
+            }
+            if (Policy::comments && p != end_ && *p == '*')
+            {
+                for (++p; p != end_ && !(*p == '*' && p + 1 != end_ && p[1] == '/'); ++p)
+                {
+                }
+                p = p != end_ ? p + 2 : end_;
+                continue;
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        if (first)
+        {
+            first = false;
+            if (ch != '}' && ch != ']')
+            {
+                elementCounts_[stack.back()] = 1;
+            }
+        }
+
+        switch (ch)
+        {
+        case '{':
+        case '[':
+            stack.push_back(elementCounts_.size());
+            elementCounts_.push_back(0);
+            first = true;
+            break;
+
+        case '}':
+        case ']':
+            if (!stack.empty())
+            {
+                stack.pop_back();
+            }
+            break;
+
+        case ',':
+            if (!stack.empty())
+            {
+                ++elementCounts_[stack.back()];
+            }
+            break;
+
+        case '"':
+            while (true)
+            {
+                const char *quote = (const char*)memchr(p, '"', end_ - p);
+                if (quote == nullptr)
+                {
+                    p = end_;
+                    break;
+                }
+                // 引号前面有奇数个'\\'时，引号是被转义的
+                const char *slash = quote;
+                while (slash != p && slash[-1] == '\\')
+                {
+                    --slash;
+                }
+                p = quote + 1;
+                if (((quote - slash) & 1) == 0)
+                {
+                    break;
+                }
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+template<typename Policy>
+bool BasicParser<Policy>::parseNumber(Node &node)
+{
+    NumberResult result;
+    if (!scanNumber(result))
+    {
+        return false;
+    }
+    setNumber(node, result);
+    return true;
+}
+
+template<typename Policy>
+bool BasicParser<Policy>::scanNumber(NumberResult &result)
+{
+    // 数字的第一个字符已经被getChar读取
+    const char *p = Policy::extendedNumbers
+        ? smartjson::parseExtendedNumber(cursor_ - 1, end_, result)
+        : smartjson::parseNumber(cursor_ - 1, end_, result);
+
+    // 数字后面可以是空白或结构字符
+    if (p == nullptr || (p != end_ && !isDelimiter(*p)))
+    {
+        return onError(RC_INVALID_NUMBER);
+    }
+
+    cursor_ = p;
+    return true;
+}
+
+template<typename Policy>
+bool BasicParser<Policy>::parseString(Node &node)
+{
+    const char *str;
+    size_t length;
+    if (!scanString(str, length))
+    {
+        return false;
+    }
+
+    // 内容没有变化的字符串，直接使用原来的节点
+    if (reuse_ != nullptr && reuse_->isString() && reuse_->size() == length &&
+        memcmp(reuse_->rawCString(), str, length) == 0)
+    {
+        node = *reuse_;
+        return true;
+    }
+
+    if (source_ != nullptr && length != 0)
+    {
+        node = allocator_->createSharedString(str, length, source_);
+    }
+    else
+    {
+        node = allocator_->createString(str, length, BT_MAKE_COPY);
+    }
+    return true;
+}
+
+template<typename Policy>
+bool BasicParser<Policy>::scanString(const char *&str, size_t &length)
+{
+    if (source_ != nullptr)
+    {
+        return scanStringInSitu(str, length);
+    }
+
+    // 不包含转义字符的字符串，直接引用输入数据，不需要拷贝
+    const char *begin = cursor_;
+    const char *p = findStringSpecial(begin, end_);
+    cursor_ = p;
+    if (p != end_ && *p == '"')
+    {
+        ++cursor_;
+        str = begin;
+        length = p - begin;
+        return checkUTF8(begin, str, length);
+    }
+
+    stringBuffer_.assign(begin, p);
+    while (1)
+    {
+        char ch = getChar();
+        if (ch == '"')
+        {
+            break;
+        }
+        else if (ch == '\\')
+        {
+            ch = getChar();
+            if (Policy::extendedEscapes && ch == 'x')
+            {
+                int codepoint = 0;
+                for (size_t i = 0; i < 2; ++i)
+                {
+                    int v = toHex(getChar());
+                    if (v < 0)
+                    {
+                        return onError(RC_INVALID_CHAR);
+                    }
+                    codepoint = (codepoint << 4) | v;
+                }
+                stringBuffer_.push_back((char)codepoint);
+            }
+            else if (ch == 'u')
+            {
+                unsigned int unicode;
+                if (!parseUnicodeChar(unicode))
+                {
+                    return false;
+                }
+
+                char utf8[4];
+                size_t n = unicodeCharToUTF8(utf8, unicode);
+                stringBuffer_.insert(stringBuffer_.end(), utf8, utf8 + n);
+            }
+            else if (!Policy::extendedEscapes && !isEscapeChar(ch))
+            {
+                return onError(RC_INVALID_CHAR);
+            }
+            else
+            {
+                ch = translateChar(ch);
+                stringBuffer_.push_back(ch);
+            }
+        }
+        else
+        {
+            return onError(RC_INVALID_STRING);
+        }
+
+        // 转义字符之后的片段整体拷贝
+        p = findStringSpecial(cursor_, end_);
+        stringBuffer_.insert(stringBuffer_.end(), cursor_, p);
+        cursor_ = p;
+    }
+
+    str = stringBuffer_.data();
+    length = stringBuffer_.size();
+    return checkUTF8(begin, str, length);
+}
+
+/** 转义字符解码后的长度不会超过原始长度，因此可以直接在输入数据上解码。
+ *  字符串末尾的引号会被替换为'\0'。
+ */
+template<typename Policy>
+bool BasicParser<Policy>::scanStringInSitu(const char *&str, size_t &length)
+{
+    // 原地解析时，输入数据来自可写的source_
+    char *begin = const_cast<char*>(cursor_);
+    char *dest = begin;
+    while (1)
+    {
+        // 不包含特殊字符的片段整体移动，遇到第一个转义字符之前不需要移动
+        const char *p = findStringSpecial(cursor_, end_);
+        if (dest != cursor_)
+        {
+            memmove(dest, cursor_, p - cursor_);
+        }
+        dest += p - cursor_;
+        cursor_ = p;
+
+        char ch = getChar();
+        if (ch == '"')
+        {
+            break;
+        }
+        else if (ch == '\\')
+        {
+            ch = getChar();
+            if (Policy::extendedEscapes && ch == 'x')
+            {
+                int codepoint = 0;
+                for (size_t i = 0; i < 2; ++i)
+                {
+                    int v = toHex(getChar());
+                    if (v < 0)
+                    {
+                        return onError(RC_INVALID_CHAR);
+                    }
+                    codepoint = (codepoint << 4) | v;
+                }
+                *dest++ = (char)codepoint;
+            }
+            else if (ch == 'u')
+            {
+                unsigned int unicode;
+                if (!parseUnicodeChar(unicode))
+                {
+                    return false;
+                }
+                dest += unicodeCharToUTF8(dest, unicode);
+            }
+            else if (!Policy::extendedEscapes && !isEscapeChar(ch))
+            {
+                return onError(RC_INVALID_CHAR);
+            }
+            else
+            {
+                *dest++ = translateChar(ch);
+            }
         }
-        else if (ch != ',')
+        else
         {
-            return onError(RC_INVALID_DICT);
+            return onError(RC_INVALID_STRING);
         }
     }
-    return false;
+
+    *dest = '\0';
+    str = begin;
+    length = dest - begin;
+    return checkUTF8(begin, str, length);
 }
 
-bool Parser::parseArray(Node &node)
+template<typename Policy>
+inline bool BasicParser<Policy>::checkUTF8(const char *start, const char *str, size_t length)
 {
-    node.setArray(allocator_);
-    
-    char ch = aheadToken();
-    if(ch == ']')
+    if (!validateUTF8_)
     {
-        nextToken();
         return true;
     }
 
-    while (true)
+    const char *error = smartjson::validateUTF8(str, str + length);
+    if (error == nullptr)
     {
-        Node child;
-        if (!parseValue(child))
-        {
-            return false;
-        }
-    
-        node.pushBack(child);
-        
-        char ch = nextToken();
-        if(ch == ']')
-        {
-            return true;
-        }
-        else if(ch != ',')
-        {
-            return onError(RC_INVALID_ARRAY);
-        }
+        return true;
     }
-    return false;
+
+    // 没有转义字符时，字符串就是输入数据本身，可以定位到非法的字节
+    bool sameAsInput = (str == start && (size_t)(cursor_ - 1 - start) == length);
+    cursor_ = sameAsInput ? error : start;
+    return onError(RC_INVALID_UTF8);
 }
 
-static int toHex(char ch)
+template<typename Policy>
+bool BasicParser<Policy>::matchLiteral(const char *rest, int errorCode)
 {
-    if (ch >= '0' && ch <= '9')
+    for (; *rest != 0; ++rest)
     {
-        return ch - '0';
+        if (getChar() != *rest)
+        {
+            return onError(errorCode);
+        }
     }
-    if (ch >= 'a' && ch <= 'f')
+    return true;
+}
+
+template<typename Policy>
+bool BasicParser<Policy>::parseTrue(Node &node)
+{
+    if (!matchLiteral("rue", RC_INVALID_TRUE))
     {
-        return ch - 'a' + 10;
+        return false;
     }
-    if (ch >= 'A' && ch <= 'F')
+    node = true;
+    return true;
+}
+
+template<typename Policy>
+bool BasicParser<Policy>::parseFalse(Node &node)
+{
+    if (!matchLiteral("alse", RC_INVALID_FALSE))
     {
-        return ch - 'A' + 10;
+        return false;
     }
-    return -1;
+    node = false;
+    return true;
 }
 
-static int toOct(char ch)
+template<typename Policy>
+bool BasicParser<Policy>::parseNull(Node &node)
 {
-    if (ch >= '0' && ch <= '7')
+    if (!matchLiteral("ull", RC_INVALID_NULL))
     {
-        return ch - '0';
+        return false;
     }
-    return -1;
+    node.setNull();
+    return true;
 }
 
-bool Parser::parseNumber(Node &node, char ch)
+template<typename Policy>
+bool BasicParser<Policy>::checkHandler(bool ret)
 {
-    Integer value = 0;
-    double real = 0;
-    int exponent = 0;
-    int sign = 1;
-    bool isFloat = false;
+    return ret ? true : onError(RC_HANDLER_ABORTED);
+}
 
-    if (ch == '-')
-    {
-        sign = -1;
-        ch = getChar();
-    }
-    else if (ch == '+')
-    {
-        ch = getChar();
-    }
-    
-    if (ch < '0' || ch > '9')
+template<typename Policy>
+bool BasicParser<Policy>::emitNumber(const NumberResult &result)
+{
+    if (isInteger(result))
     {
-        return onError(RC_INVALID_NUMBER);
+        return checkHandler(handler_->onInt((Integer)result.integer));
     }
-    
-    if (ch == '0')
+    return checkHandler(handler_->onFloat(result.isFloat ? result.real : (double)result.integer));
+}
+
+/** 非递归地解析一个值并回调handler_。
+ *  未完成的容器保存在emitFrames_中，而不是函数调用栈上，嵌套深度受maxDepth_限制。
+ */
+template<typename Policy>
+bool BasicParser<Policy>::emitValue()
+{
+    // skipValue可能在其它解析流程中被调用，只使用base之上的部分
+    const size_t base = emitFrames_.size();
+    bool ret = emitValues(base);
+    emitFrames_.resize(base);
+    return ret;
+}
+
+template<typename Policy>
+bool BasicParser<Policy>::emitValues(size_t base)
+{
+    while (true)
     {
-        ch = getChar();
+        int ch = nextToken();
+        while (ch == '/')
+        {
+            if (!parseComment())
+            {
+                return false;
+            }
+            ch = nextToken();
+        }
+
         switch (ch)
         {
-        case 'x':
-        case 'X':
-            while (true)
+        case '\0':
+            return onError(RC_END_OF_FILE);
+
+        case '{':
+        case '[':
+        {
+            bool isDict = ch == '{';
+            if (++depth_ > maxDepth_)
             {
-                ch = getChar();
-                int v = toHex(ch);
-                if (v < 0)
+                return onError(RC_TOO_DEEP);
+            }
+            if (!checkHandler(isDict ? handler_->onStartDict() : handler_->onStartArray()))
+            {
+                return false;
+            }
+
+            char next = aheadToken();
+            if (next == (isDict ? '}' : ']'))
+            {
+                nextToken();
+                --depth_;
+                if (!checkHandler(isDict ? handler_->onEndDict(0) : handler_->onEndArray(0)))
                 {
-                    break;
+                    return false;
                 }
-                value = (value << 4) | v;
+                break;
+            }
+            if (isDict && next == 0)
+            {
+                return onError(RC_INVALID_DICT);
+            }
+
+            emitFrames_.push_back(EmitFrame{ isDict, 0 });
+            if (isDict && !emitMember())
+            {
+                return false;
+            }
+            // 继续读取容器的第一个元素
+            continue;
+        }
+
+        case '"':
+        {
+            const char *str;
+            size_t length;
+            if (!scanString(str, length) || !checkHandler(handler_->onString(str, length)))
+            {
+                return false;
             }
             break;
-        case 'o':
-        case 'O':
-            while (true)
+        }
+
+        case 'n':
+            if (!matchLiteral("ull", RC_INVALID_NULL) || !checkHandler(handler_->onNull()))
             {
-                ch = getChar();
-                int v = toOct(ch);
-                if (v < 0)
-                {
-                    break;
-                }
-                value = (value << 3) | v;
+                return false;
             }
             break;
-        case 'b':
-        case 'B':
-            while (true)
+
+        case 't':
+            if (!matchLiteral("rue", RC_INVALID_TRUE) || !checkHandler(handler_->onBool(true)))
             {
-                ch = getChar();
-                if (ch == '1')
-                {
-                    value = (value << 1) | 1;
-                }
-                else if (ch == '0')
-                {
-                    value = (value << 1);
-                }
-                else
-                {
-                    break;
-                }
+                return false;
             }
             break;
-        case '.':
-            isFloat = true;
+
+        case 'f':
+            if (!matchLiteral("alse", RC_INVALID_FALSE) || !checkHandler(handler_->onBool(false)))
+            {
+                return false;
+            }
             break;
+
         default:
+        {
+            NumberResult result;
+            if (!scanNumber(result) || !emitNumber(result))
+            {
+                return false;
+            }
             break;
         }
-    }
-    else
-    {
-        while(ch >= '0' && ch <= '9')
-        {
-            value = value * 10 + (ch - '0');
-            ch = getChar();
         }
 
-        isFloat = ch == '.';
-    }
-    
-    if (isFloat)
-    {
-        Integer num = 0;
-        Integer den = 1;
-
-        ch = getChar();
-        while (ch >= '0' && ch <= '9')
+        // 一个值已经完成，处理所在容器的','和结束符
+        while (true)
         {
-            num = num * 10 + (ch - '0');
-            den *= 10;
-            ch = getChar();
-        }
-        
-        int expSign = 1;
-        if(ch == 'e' || ch == 'E')
-        {
-            ch = getChar();
-            if(ch == '-')
+            if (emitFrames_.size() == base)
             {
-                expSign = -1;
-                ch = getChar();
+                return true;
             }
-            else if(ch == '+')
+
+            EmitFrame &frame = emitFrames_.back();
+            ++frame.count;
+            ch = nextToken();
+            if (ch == ',')
             {
-                ch = getChar();
+                if (frame.isDict && !emitMember())
+                {
+                    return false;
+                }
+                break;
             }
-            else if (ch < '0' || ch > '9')
+            if (ch != (frame.isDict ? '}' : ']'))
             {
-                return onError(RC_INVALID_NUMBER);
+                return onError(frame.isDict ? RC_INVALID_DICT : RC_INVALID_ARRAY);
             }
-            
-            while (ch >= '0' && ch <= '9')
+
+            bool isDict = frame.isDict;
+            size_t count = frame.count;
+            emitFrames_.pop_back();
+            --depth_;
+            if (!checkHandler(isDict ? handler_->onEndDict(count) : handler_->onEndArray(count)))
             {
-                exponent = exponent * 10 + (ch - '0');
-                ch = getChar();
+                return false;
             }
         }
-
-        real = value + (double)num / den;
-        if (exponent != 0)
-        {
-            real *= pow(10.0, exponent * expSign);
-        }
-    }
-    
-    if (ch != ',' && ch != ']' && ch != '}')
-    {
-        return onError(RC_INVALID_NUMBER);
     }
-    ungetChar(ch);
-    
-    if(isFloat)
+}
+
+/** 字典元素的key和后面的':' */
+template<typename Policy>
+bool BasicParser<Policy>::emitMember()
+{
+    if (!emitKey())
     {
-        real *= sign;
-        node = real;
+        return false;
     }
-    else
+    if (nextToken() != ':')
     {
-        value *= sign;
-        node = value;
+        return onError(RC_INVALID_DICT);
     }
     return true;
 }
 
-bool Parser::parseString(Node &node)
+template<typename Policy>
+bool BasicParser<Policy>::emitKey()
 {
-    stringBuffer_.clear();
-    while (1)
+    while (errorCode_ == RC_OK)
     {
-        char ch = getChar();
-        if (ch == 0 || ch == '\n')
+        int ch = nextToken();
+        if (ch == '/')
         {
-            return onError(RC_INVALID_STRING);
+            parseComment();
         }
         else if (ch == '"')
         {
-            break;
+            const char *str;
+            size_t length;
+            return scanString(str, length) && checkHandler(handler_->onKey(str, length));
         }
-        else if (ch == '\\')
+        else if (Policy::integerKeys && (ch == '-' || ch == '+' || (ch >= '0' && ch <= '9')))
         {
-            ch = getChar();
-            if (ch == 'x')
+            NumberResult result;
+            if (!scanNumber(result))
             {
-                int codepoint = 0;
-                for (size_t i = 0; i < 2; ++i)
-                {
-                    int v = toHex(getChar());
-                    if (v < 0)
-                    {
-                        return onError(RC_INVALID_CHAR);
-                    }
-                    codepoint = (codepoint << 4) | v;
-                }
-                stringBuffer_.push_back((char)codepoint);
-            }
-            else if (ch == 'u')
-            {
-                parseUnicodeChar();
+                return false;
             }
-            else
+            if (!isInteger(result))
             {
-                ch = translateChar(ch);
-                stringBuffer_.push_back(ch);
+                return onError(RC_INVALID_KEY);
             }
+            return checkHandler(handler_->onInt((Integer)result.integer));
+        }
+        else if (ch == 0)
+        {
+            return onError(RC_END_OF_FILE);
         }
         else
         {
-            stringBuffer_.push_back(ch);
+            return onError(RC_INVALID_KEY);
         }
     }
-
-    node = allocator_->createString(stringBuffer_.data(), stringBuffer_.size(), BT_MAKE_COPY);
-    return true;
-}
-
-bool Parser::parseTrue(Node &node)
-{
-    if (getChar() == 'r' &&
-        getChar() == 'u' &&
-        getChar() == 'e')
-    {
-        node = true;
-        return true;
-    }
-    return onError(RC_INVALID_TRUE);
-}
-
-bool Parser::parseFalse(Node &node)
-{
-    if (getChar() == 'a' &&
-        getChar() == 'l' &&
-        getChar() == 's' &&
-        getChar() == 'e')
-    {
-        node = false;
-        return true;
-    }
-    return onError(RC_INVALID_FALSE);
+    return false;
 }
 
-bool Parser::parseNull(Node &node)
+template<typename Policy>
+bool BasicParser<Policy>::parseComment()
 {
-    if (getChar() == 'u' &&
-        getChar() == 'l' &&
-        getChar() == 'l')
+    if (!Policy::comments)
     {
-        node.setNull();
-        return true;
+        return onError(RC_INVALID_COMMENT);
     }
-    return onError(RC_INVALID_NULL);
-}
 
-bool Parser::parseComment()
-{
     int nextCh = getChar();
     if (nextCh == '/')
     {
@@ -664,7 +1632,8 @@ bool Parser::parseComment()
     return true;
 }
 
-bool Parser::parseLineComment()
+template<typename Policy>
+bool BasicParser<Policy>::parseLineComment()
 {
     char ch;
     do
@@ -674,7 +1643,8 @@ bool Parser::parseLineComment()
     return true;
 }
 
-bool Parser::parseLongComment()
+template<typename Policy>
+bool BasicParser<Policy>::parseLongComment()
 {
     while (true)
     {
@@ -696,34 +1666,8 @@ bool Parser::parseLongComment()
     return true;
 }
 
-static inline void unicodeCharToUTF8(std::vector<char> &buffer, unsigned int cp)
-{
-    // based on description from http://en.wikipedia.org/wiki/UTF-8
-    if (cp <= 0x7f)
-    {
-        buffer.push_back(static_cast<char>(cp));
-    }
-    else if (cp <= 0x7FF)
-    {
-        buffer.push_back(static_cast<char>(0xC0 | (0x1f & (cp >> 6))));
-        buffer.push_back(static_cast<char>(0x80 | (0x3f & cp)));
-    }
-    else if (cp <= 0xFFFF)
-    {
-        buffer.push_back(static_cast<char>(0xE0 | (0xf & (cp >> 12))));
-        buffer.push_back(static_cast<char>(0x80 | (0x3f & (cp >> 6))));
-        buffer.push_back(static_cast<char>(0x80 | (0x3f & cp)));
-    }
-    else if (cp <= 0x10FFFF)
-    {
-        buffer.push_back(static_cast<char>(0xF0 | (0x7 & (cp >> 18))));
-        buffer.push_back(static_cast<char>(0x80 | (0x3f & (cp >> 12))));
-        buffer.push_back(static_cast<char>(0x80 | (0x3f & (cp >> 6))));
-        buffer.push_back(static_cast<char>(0x80 | (0x3f & cp)));
-    }
-}
-
-bool Parser::parseUnicodeChar()
+template<typename Policy>
+bool BasicParser<Policy>::parseUnicodeChar(unsigned int &unicode)
 {
     unsigned int code = 0;
     for (size_t index = 0; index < 4; ++index)
@@ -735,7 +1679,7 @@ bool Parser::parseUnicodeChar()
         }
         code = (code << 4) | (unsigned int)v;
     }
-    unsigned int unicode = code;
+    unicode = code;
 
     if (code >= 0xD800 && code <= 0xDBFF)
     {
@@ -759,35 +1703,16 @@ bool Parser::parseUnicodeChar()
             return onError(RC_INVALID_UNICODE);
         }
     }
-
-    unicodeCharToUTF8(stringBuffer_, unicode);
     return true;
 }
 
+template class BasicParser<Relaxed>;
+template class BasicParser<StrictRFC8259>;
+
 //////////////////////////////////////////////////////////////////////
 // Json Writer
 //////////////////////////////////////////////////////////////////////
 
-struct Tab
-{
-    int             n_;
-    const char*     tab_;
-    
-    Tab(int n, const char *tab)
-    : n_(n)
-    , tab_(tab)
-    {}
-    
-    friend std::ostream& operator << (std::ostream& out, const Tab &tab)
-    {
-        for(int i = 0; i < tab.n_; ++i)
-        {
-            out << tab.tab_;
-        }
-        return out;
-    }
-};
-
 Writer::Writer(const char *tab, const char *eol)
 {
     tab_ = tab;
@@ -796,11 +1721,20 @@ Writer::Writer(const char *tab, const char *eol)
 
 void Writer::onWrite(const Node &node)
 {
-    writeNode(node, *stream_, 0);
-    *stream_ << eol_;
+    writeNode(node, *sink_, 0);
+    sink_->write(eol_);
+}
+
+void Writer::writeIndent(IOutputSink &out, int depth)
+{
+    size_t length = strlen(tab_);
+    for (int i = 0; i < depth; ++i)
+    {
+        out.write(tab_, length);
+    }
 }
 
-void Writer::writeNode(const Node &node, std::ostream &out, int depth)
+void Writer::writeNode(const Node &node, IOutputSink &out, int depth)
 {
     switch (node.getType())
     {
@@ -830,101 +1764,122 @@ void Writer::writeNode(const Node &node, std::ostream &out, int depth)
     }
 }
 
-void Writer::writeNull(const Node &node, std::ostream &out)
+void Writer::writeNull(const Node &node, IOutputSink &out)
 {
-    out << "null";
+    out.write("null", 4);
 }
 
-void Writer::writeBool(const Node &node, std::ostream &out)
+void Writer::writeBool(const Node &node, IOutputSink &out)
 {
-    out << (node.asBool() ? "true" : "false");
+    if (node.asBool())
+    {
+        out.write("true", 4);
+    }
+    else
+    {
+        out.write("false", 5);
+    }
 }
 
-void Writer::writeInt(const Node &node, std::ostream &out)
+void Writer::writeInt(const Node &node, IOutputSink &out)
 {
-    out << node.asInteger();
+    char buffer[MAX_NUMBER_LENGTH];
+    out.write(buffer, formatInteger(buffer, node.asInteger()));
 }
 
-void Writer::writeFloat(const Node &node, std::ostream &out)
+void Writer::writeFloat(const Node &node, IOutputSink &out)
 {
-    out << node.asFloat();
+    char buffer[MAX_NUMBER_LENGTH];
+    out.write(buffer, formatFloat(buffer, node.asFloat()));
 }
 
-void Writer::writeString(const Node &node, std::ostream &out)
+void Writer::writeString(const Node &node, IOutputSink &out)
 {
     const char *begin = node.asCString();
     const char *end = begin + node.size();
     
-    out << "\"";
+    out.put('"');
     for(const char *p = begin; p != end; ++p)
     {
+        // 不需要转义的片段直接输出
+        const char *q = findEscapeChar(p, end);
+        out.write(p, q - p);
+        p = q;
+        if (p == end)
+        {
+            break;
+        }
+
         switch(*p)
         {
         case '\n':
-            out << "\\n";
+            out.write("\\n", 2);
             break;
         case '\t':
-            out << "\\t";
+            out.write("\\t", 2);
             break;
         case '\r':
-            out << "\\r";
+            out.write("\\r", 2);
             break;
         case '\\':
-            out << "\\\\";
+            out.write("\\\\", 2);
             break;
         case '\b':
-            out << "\\b";
+            out.write("\\b", 2);
             break;
         case '\f':
-            out << "\\f";
+            out.write("\\f", 2);
             break;
         case '\"':
-            out << "\\\"";
+            out.write("\\\"", 2);
             break;
         case '\0':
-            out << "\\0";
+            out.write("\\0", 2);
             break;
         default:
-            out << *p;
+            out.put(*p);
             break;
         }
     }
-    out << "\"";
+    out.put('"');
 }
 
-void Writer::writeArray(const Node &node, std::ostream &out, int depth)
+void Writer::writeArray(const Node &node, IOutputSink &out, int depth)
 {
     if(node.size() == 0)
     {
-        out << "[]";
+        out.write("[]", 2);
         return;
     }
     
-    out << "[" << eol_;
+    out.put('[');
+    out.write(eol_);
     size_t n = node.size();
     for(size_t i = 0; i < n; ++i)
     {
-        out << Tab(depth + 1, tab_);
+        writeIndent(out, depth + 1);
         writeNode(node[i], out, depth + 1);
         
         if (endComma_ || i + 1 != n)
         {
-            out << ',';
+            out.put(',');
         }
-        out << eol_;
+        out.write(eol_);
     }
-    out << Tab(depth, tab_) << "]";
+    writeIndent(out, depth);
+    out.put(']');
 }
 
-void Writer::writeDict(const Node &node, std::ostream &out, int depth)
+void Writer::writeDict(const Node &node, IOutputSink &out, int depth)
 {
     if(node.size() == 0)
     {
-        out << "{}";
+        out.write("{}", 2);
         return;
     }
     
-    out << "{" << eol_;
+    out.put('{');
+    out.write(eol_);
 
     const Dict &dict = node.refDict();
     size_t n = dict.size();
@@ -936,72 +1891,79 @@ void Writer::writeDict(const Node &node, std::ostream &out, int depth)
 
         for (const NodePair& pair : members)
         {
-            out << Tab(depth + 1, tab_);
+            writeIndent(out, depth + 1);
             writeNode(pair.first, out, depth + 1);
-            out << seperator_;
+            out.write(seperator_);
             writeNode(pair.second, out, depth + 1);
 
             --n;
             if (endComma_ || n != 0)
             {
-                out << ',';
+                out.put(',');
             }
 
-            out << eol_;
+            out.write(eol_);
         }
     }
     else
     {
         for (const NodePair& pair : dict)
         {
-            out << Tab(depth + 1, tab_);
+            writeIndent(out, depth + 1);
             writeNode(pair.first, out, depth + 1);
-            out << seperator_;
+            out.write(seperator_);
             writeNode(pair.second, out, depth + 1);
 
             --n;
             if (endComma_ || n != 0)
             {
-                out << ',';
+                out.put(',');
             }
 
-            out << eol_;
+            out.write(eol_);
         }
     }
     
-    out << Tab(depth, tab_) << "}";
+    writeIndent(out, depth);
+    out.put('}');
 }
 
 std::ostream& operator << (std::ostream & stream, const Node &v)
 {
-    switch (v.getType())
-    {
-    case T_NULL:
-        stream << "null";
-        break;
-    case T_BOOL:
-        stream << (v.rawBool() ? "true" : "false");
-        break;
-    case T_INT:
-        stream << v.rawInteger();
-        break;
-    case T_FLOAT:
-        stream << v.rawFloat();
-        break;
-    case T_STRING:
-    {
-        StringValue *s = v.rawString();
-        stream.write(s->data(), s->size());
-        break;
-    }
-    case T_ARRAY:
-        stream << "array[" << v.size() << "]";
-        break;
-    case T_DICT:
-        stream << "dict[" << v.size() << "]";
-        break;
+    switch (v.getType())
+    {
+    case T_NULL:
+        stream << "null";
+        break;
+    case T_BOOL:
+        stream << (v.rawBool() ? "true" : "false");
+        break;
+    case T_INT:
+    {
+        char buffer[MAX_NUMBER_LENGTH];
+        stream.write(buffer, formatInteger(buffer, v.rawInteger()));
+        break;
+    }
+    case T_FLOAT:
+    {
+        char buffer[MAX_NUMBER_LENGTH];
+        stream.write(buffer, formatFloat(buffer, v.rawFloat()));
+        break;
+    }
+    case T_STRING:
+    {
+        StringValue *s = v.rawString();
+        stream.write(s->data(), s->size());
+        break;
+    }
+    case T_ARRAY:
+        stream << "array[" << v.size() << "]";
+        break;
+    case T_DICT:
+        stream << "dict[" << v.size() << "]";
+        break;
     default:
-        break;
+        break;
     }
     return stream;
 }
@@ -1,9 +1,14 @@
 ﻿#pragma once
 #include "sj_node.hpp"
+#include "sj_handler.hpp"
+#include "sj_output_sink.hpp"
 #include <iostream>
 
 NS_SMARTJSON_BEGIN
 
+class SourceBuffer;
+struct NumberResult;
+
 class IParser
 {
     SJ_DISABLE_COPY_ASSIGN(IParser);
@@ -19,6 +24,12 @@ public:
 
     bool parse(std::istream &stream);
 
+    /** 直接解析内存中的数据，解析过程中不会拷贝数据 */
+    bool parse(const char *data, size_t length);
+
+    /** 原地解析。解析结果中的字符串直接引用buffer中的数据，并会修改buffer的内容 */
+    bool parse(SourceBuffer *buffer);
+
     Node getRoot() const { return root_; }
     int getErrorCode() const { return errorCode_; }
 
@@ -30,10 +41,35 @@ protected:
 protected:
 
     IAllocator*     allocator_;
-    std::istream*   stream_ = nullptr;
+    /** 输入数据的范围[begin_, end_)，cursor_指向当前读取的位置 */
+    const char*     begin_ = nullptr;
+    const char*     cursor_ = nullptr;
+    const char*     end_ = nullptr;
+    /** 原地解析时的输入缓冲区 */
+    SourceBuffer*   source_ = nullptr;
     Node            root_;
     int 			errorCode_ = RC_OK;
     bool            isBinaryFile_ = false;
+
+public:
+    /** 原地解析模式(in-situ)。
+     *  字符串节点直接引用输入数据，不再拷贝，包含转义字符的字符串会在输入数据上原地解码。
+     *  parseFromFile会以写时复制的方式映射文件；parseFromData和parseFromString会先拷贝一份输入数据。
+     *  只要还有字符串节点存在，输入数据就不会被释放。BinaryParser忽略此选项。
+     */
+    bool            inSitu_ = false;
+
+    /** 数组和字典的最大嵌套深度，超过时返回RC_TOO_DEEP。
+     *  解析过程(包括事件驱动解析和路径过滤)不在函数调用栈上递归，未完成的容器保存在堆上，
+     *  这个限制避免恶意或错误的数据在之后递归处理节点树时(如Writer和节点析构)耗尽线程栈。
+     */
+    size_t          maxDepth_ = 1024;
+
+    /** 预先统计每个数组和字典的元素个数，创建容器时一次性分配好内存，避免数组扩容和字典rehash。
+     *  Parser需要额外扫描一遍输入数据；FastParser直接使用结构字符索引统计；ParallelParser在每段中分别统计。
+     *  设置了handler或路径过滤器时不生效，BinaryParser忽略此选项(二进制数据中已经记录了元素个数)。
+     */
+    bool            presize_ = false;
 };
 
 class IWriter
@@ -45,6 +81,8 @@ public:
     bool writeToFile(const Node &node, const char *fileName);
     bool writeToFile(const Node &node, const std::string& fileName);
 
+    /** 写入输出目标，结束时会调用out.flush() */
+    bool write(const Node &node, IOutputSink &out);
     bool write(const Node &node, std::ostream &out);
     std::string toString(const Node &node);
 
@@ -67,29 +105,95 @@ public:
     bool            isBinaryFile_ = false;
 
 protected:
-    std::ostream*   stream_ = nullptr;
+    IOutputSink*    sink_ = nullptr;
     int 			errorCode_ = RC_OK;
 };
 
+/** 默认的语法策略，支持以下扩展：
+ *  '//'和块注释、数字前的'+'号、0x/0o/0b开头的整数、字符串中的'\x'转义和未定义的转义字符(当作字符本身)、字典的整数key。
+ */
+struct Relaxed
+{
+    static const bool comments = true;
+    static const bool extendedNumbers = true;
+    static const bool extendedEscapes = true;
+    static const bool integerKeys = true;
+};
+
+/** 严格按照RFC 8259解析，不支持任何扩展。适合解析由程序生成的数据 */
+struct StrictRFC8259
+{
+    static const bool comments = false;
+    static const bool extendedNumbers = false;
+    static const bool extendedEscapes = false;
+    static const bool integerKeys = false;
+};
+
 /** json parser.
  *  bnf: http://www.json.org/json-zh.html
  *  NOTICE: The format '\uxxxx' doesn't supported.
+ *
+ *  Policy在编译期决定支持哪些语法扩展，不支持的扩展相关的分支会被编译器去掉。
+ *  实现位于sj_parser.cpp，只实例化了Relaxed和StrictRFC8259。
  */
-class Parser : public IParser
+template<typename Policy>
+class BasicParser : public IParser
 {
-    SJ_DISABLE_COPY_ASSIGN(Parser);
+    SJ_DISABLE_COPY_ASSIGN(BasicParser);
 public:
-    explicit Parser(IAllocator *allocator = nullptr);
+    explicit BasicParser(IAllocator *allocator = nullptr);
     
-    int getLine() const { return line_; }
-    int getColumn() const { return column_; }
+    /** 出错的行号和列号，从1开始。
+     *  解析时只记录出错的字节偏移，行号和列号在出错后根据输入数据计算，不占用正常解析的时间。
+     *  没有出错时，返回当前读取位置的行号和列号(需要输入数据还在，如JsonReader)。
+     */
+    int getLine() const;
+    int getColumn() const;
+    /** 出错位置相对于输入数据起始位置的字节偏移 */
+    size_t getErrorOffset() const { return errorOffset_; }
 
-private:
+    /** 设置事件处理器(SAX)。设置后解析时不再创建节点，getRoot()返回空节点。
+     *  handler的生命周期由调用者管理，传入nullptr恢复为创建节点。
+     */
+    void setHandler(IHandler *handler) { handler_ = handler; }
+    IHandler* getHandler() const { return handler_; }
+
+    /** 只创建指定路径上的节点，路径的格式与findMemberByPath相同，如"a/b/c"。
+     *  路径之外的值只做格式检查，直接跳过，不会分配内存；路径上的中间字典总是会被创建。
+     *  根节点是数组时，结果是空数组。paths为空时，恢复为创建所有节点。
+     */
+    void setPathFilter(const std::vector<std::string> &paths);
+
+    /** 解析数据，结果写入existing。适合反复加载结构基本相同的数据，如配置文件的热更新。
+     *  existing中只被它自己引用的数组和字典会被复用，内容没有变化的字符串保留原来的节点，
+     *  只有结构不同的部分才会分配内存。被其他节点共享的容器不会被修改。
+     *  解析前会先校验一遍格式，失败时existing保持不变。设置了handler时不会修改existing。
+     */
+    bool parseInto(Node &existing, const char *data, size_t length);
+    bool parseInto(Node &existing, const std::string &str);
+
+public:
+    /** JSON Lines(NDJSON)格式：每行一个任意类型的json值，值和注释都不能跨越多行，空行会被忽略。
+     *  根节点是数组，依次保存每一行的值。设置了handler时，依次回调每一行的值。
+     */
+    bool            jsonLines_ = false;
+
+    /** 检查字符串(包括key)是否是合法的UTF-8编码，非法时返回RC_INVALID_UTF8。
+     *  校验在扫描每个字符串时进行，不需要额外遍历输入数据。
+     *  getErrorOffset()指向非法的字节；字符串包含转义字符时，指向字符串的起始位置。
+     */
+    bool            validateUTF8_ = false;
+
+protected:
     bool doParse() override;
+    bool parseLines();
+
+    /** 记录出错的位置，再设置错误码 */
+    bool onError(int code);
+    /** 计算position所在的行号和列号 */
+    void locate(const char *position, int &line, int &column) const;
 
     char getChar();
-    void ungetChar(char ch);
-    char translateChar(char ch);
 
     int parseToken();
     int nextToken();
@@ -97,26 +201,110 @@ private:
     
     bool parseDict(Node &node);
     bool parseArray(Node &node);
-    bool parseNumber(Node &node, char ch);
+    bool parseContainer(Node &node, int open);
+    int parseScalar(Node &node);
+    bool parseNumber(Node &node);
     bool parseString(Node &node);
     bool parseTrue(Node &node);
     bool parseFalse(Node &node);
     bool parseNull(Node &node);
     bool parseValue(Node &node);
+    bool parseFilteredDict(Node &node, int filter);
+    /** 检查一个值的格式并跳过，不创建节点 */
+    bool skipValue();
+    /** presize_的预扫描，按照容器出现的顺序统计元素个数 */
+    void countElements();
+
+    /** 以下接口只解析词法单元，不创建节点 */
+    /** 解析数字，数字的第一个字符已经被读取 */
+    bool scanNumber(NumberResult &result);
+    /** 解析后的字符串，在下一次解析字符串之前有效 */
+    bool scanString(const char *&str, size_t &length);
+    bool scanStringInSitu(const char *&str, size_t &length);
+    /** validateUTF8_时检查解析出的字符串，start是字符串在输入数据中的起始位置 */
+    bool checkUTF8(const char *start, const char *str, size_t length);
+    bool matchLiteral(const char *rest, int errorCode);
+
+    /** 以下接口驱动handler_，不创建节点 */
+    bool emitValue();
+    bool emitKey();
+    bool emitValues(size_t base);
+    bool emitMember();
+    bool emitNumber(const NumberResult &result);
+    bool checkHandler(bool ret);
 
     bool parseComment();
     bool parseLineComment();
     bool parseLongComment();
     
-    bool parseUnicodeChar();
+    bool parseUnicodeChar(unsigned int &unicode);
 
-private:
+protected:
+    /** parseContainer使用的容器栈，解析结束后保留内存，供下一次使用 */
+    struct Frame
+    {
+        Node        node;
+        /** 字典中正在解析的元素的key */
+        Node        key;
+
+        /** 以下用于parseInto复用已有的容器。slot是正在解析的元素在容器中的位置 */
+        Node*       slot = nullptr;
+        /** 数组中下一个元素的下标 */
+        size_t      index = 0;
+        size_t      oldSize = 0;
+        /** 字典在reuseSlots_中记录的起始位置 */
+        size_t      slotBase = 0;
+        bool        reused = false;
+    };
+
+    bool parseReusedKey(Frame &frame);
+    void finishReused(Frame &frame);
+
+    /** 路径过滤器的前缀树，第0个是根节点 */
+    struct PathNode
+    {
+        std::string name;
+        int         parent;
+        /** 路径的终点，整个值都需要创建 */
+        bool        leaf;
+    };
+
+    int findPathNode(int parent, const char *name, size_t length) const;
+
+    IHandler*       handler_ = nullptr;
+    std::vector<PathNode> pathFilter_;
+    std::vector<Frame> frames_;
+    /** parseInto的目标节点；reuse_是下一个值在已有树中的对应节点 */
+    Node*           target_ = nullptr;
+    Node*           reuse_ = nullptr;
+    /** 复用的字典中，每个解析出的元素的值的位置 */
+    std::vector<Node*> reuseSlots_;
+    /** 预扫描得到的每个容器的元素个数，containerIndex_是下一个要创建的容器 */
+    std::vector<size_t> elementCounts_;
+    size_t          containerIndex_ = 0;
+    /** emitValue使用的容器栈，count是已经完成的元素个数 */
+    struct EmitFrame
+    {
+        bool        isDict;
+        size_t      count;
+    };
+    std::vector<EmitFrame> emitFrames_;
+    /** 事件驱动解析时的嵌套深度 */
+    size_t          depth_ = 0;
     std::vector<char> stringBuffer_;
-    int             line_;
-    int             column_;
+    /** 出错的位置，只在出错时计算 */
+    size_t          errorOffset_ = 0;
+    int             line_ = 1;
+    int             column_ = 1;
     int             nextToken_;
 };
 
+extern template class BasicParser<Relaxed>;
+extern template class BasicParser<StrictRFC8259>;
+
+typedef BasicParser<Relaxed> Parser;
+typedef BasicParser<StrictRFC8259> StrictParser;
+
 class Writer : public IWriter
 {
 public:
@@ -124,19 +312,21 @@ public:
     
     // 以下接口，外部也可以直接使用
 
-    void writeNull(const Node &node, std::ostream &out);
-    void writeBool(const Node &node, std::ostream &out);
-    void writeInt(const Node &node, std::ostream &out);
-    void writeFloat(const Node &node, std::ostream &out);
-    void writeString(const Node &node, std::ostream &out);
-    void writeNode(const Node &node, std::ostream &out, int depth);
-    void writeArray(const Node &node, std::ostream &out, int depth);
-    void writeDict(const Node &node, std::ostream &out, int depth);
+    void writeNull(const Node &node, IOutputSink &out);
+    void writeBool(const Node &node, IOutputSink &out);
+    void writeInt(const Node &node, IOutputSink &out);
+    void writeFloat(const Node &node, IOutputSink &out);
+    void writeString(const Node &node, IOutputSink &out);
+    void writeNode(const Node &node, IOutputSink &out, int depth);
+    void writeArray(const Node &node, IOutputSink &out, int depth);
+    void writeDict(const Node &node, IOutputSink &out, int depth);
     
 protected:
 
     void onWrite(const Node &node) override;
 
+    void writeIndent(IOutputSink &out, int depth);
+
 public:
     /** 字典元素分隔符 */
     const char*     seperator_ = " : ";
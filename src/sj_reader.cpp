@@ -0,0 +1,376 @@
+﻿#include "sj_reader.hpp"
+#include "sj_utils.hpp"
+
+NS_SMARTJSON_BEGIN
+
+JsonReader::JsonReader()
+    : Parser(nullptr)
+{
+}
+
+bool JsonReader::openFile(const char *fileName)
+{
+    close();
+    if (!file_.open(fileName))
+    {
+        return onError(RC_OPEN_FILE_ERROR);
+    }
+    return open(file_.data(), file_.size());
+}
+
+bool JsonReader::openFile(const std::string &fileName)
+{
+    return openFile(fileName.c_str());
+}
+
+bool JsonReader::open(const char *data, size_t length)
+{
+    begin_ = data;
+    cursor_ = data;
+    end_ = data + length;
+    errorCode_ = RC_OK;
+    line_ = 1;
+    column_ = 1;
+    errorOffset_ = 0;
+    nextToken_ = 0;
+
+    stack_.clear();
+    state_ = S_ROOT;
+    token_ = TK_END;
+    return true;
+}
+
+void JsonReader::close()
+{
+    file_.close();
+    begin_ = cursor_ = end_ = nullptr;
+    stack_.clear();
+    state_ = S_DONE;
+    token_ = TK_END;
+}
+
+JsonReader::Token JsonReader::fail(int code)
+{
+    // 保留最先发生的错误
+    if (errorCode_ == RC_OK)
+    {
+        onError(code);
+    }
+    state_ = S_DONE;
+    return token_ = TK_END;
+}
+
+int JsonReader::readToken()
+{
+    int ch = nextToken();
+    while (ch == '/')
+    {
+        if (!parseComment())
+        {
+            return 0;
+        }
+        ch = nextToken();
+    }
+    return ch;
+}
+
+JsonReader::Token JsonReader::next()
+{
+    if (errorCode_ != RC_OK)
+    {
+        return token_ = TK_END;
+    }
+
+    int ch;
+    switch (state_)
+    {
+    case S_ROOT:
+        ch = readToken();
+        if (ch == '{' || ch == '[')
+        {
+            return startContainer(ch);
+        }
+        return fail(RC_INVALID_JSON);
+
+    case S_FIRST:
+        ch = readToken();
+        if (ch == (stack_.back() == '{' ? '}' : ']'))
+        {
+            return endContainer();
+        }
+        return stack_.back() == '{' ? readKey(ch) : readValue(ch);
+
+    case S_KEY:
+        return readKey(readToken());
+
+    case S_COLON:
+        if (readToken() != ':')
+        {
+            return fail(RC_INVALID_DICT);
+        }
+        return readValue(readToken());
+
+    case S_VALUE:
+        return readValue(readToken());
+
+    case S_AFTER_VALUE:
+    {
+        bool isDict = stack_.back() == '{';
+        ch = readToken();
+        if (ch == ',')
+        {
+            return isDict ? readKey(readToken()) : readValue(readToken());
+        }
+        if (ch == (isDict ? '}' : ']'))
+        {
+            return endContainer();
+        }
+        return fail(isDict ? RC_INVALID_DICT : RC_INVALID_ARRAY);
+    }
+
+    default:
+        // 根节点后面不能有多余的内容
+        if (begin_ != nullptr && readToken() != 0)
+        {
+            return fail(RC_INVALID_JSON);
+        }
+        return token_ = TK_END;
+    }
+}
+
+JsonReader::Token JsonReader::startContainer(char ch)
+{
+    if (stack_.size() >= maxDepth_)
+    {
+        return fail(RC_TOO_DEEP);
+    }
+    stack_.push_back(ch);
+    state_ = S_FIRST;
+    return token_ = (ch == '{' ? TK_START_DICT : TK_START_ARRAY);
+}
+
+JsonReader::Token JsonReader::endContainer()
+{
+    char ch = stack_.back();
+    stack_.pop_back();
+    return finishValue(ch == '{' ? TK_END_DICT : TK_END_ARRAY);
+}
+
+JsonReader::Token JsonReader::finishValue(Token token)
+{
+    state_ = stack_.empty() ? S_DONE : S_AFTER_VALUE;
+    return token_ = token;
+}
+
+JsonReader::Token JsonReader::readValue(int ch)
+{
+    switch (ch)
+    {
+    case 0:
+        return fail(RC_END_OF_FILE);
+
+    case '{':
+    case '[':
+        return startContainer((char)ch);
+
+    case '"':
+        if (!scanString(str_, length_))
+        {
+            return fail(RC_INVALID_STRING);
+        }
+        return finishValue(TK_STRING);
+
+    case 'n':
+        if (!matchLiteral("ull", RC_INVALID_NULL))
+        {
+            return fail(RC_INVALID_NULL);
+        }
+        return finishValue(TK_NULL);
+
+    case 't':
+    case 'f':
+        if (!matchLiteral(ch == 't' ? "rue" : "alse", ch == 't' ? RC_INVALID_TRUE : RC_INVALID_FALSE))
+        {
+            return fail(RC_INVALID_JSON);
+        }
+        bool_ = ch == 't';
+        return finishValue(TK_BOOL);
+
+    default:
+        if (!scanNumber(number_))
+        {
+            return fail(RC_INVALID_NUMBER);
+        }
+        if (isInteger(number_))
+        {
+            return finishValue(TK_INT);
+        }
+        number_.real = getFloat();
+        number_.isFloat = true;
+        return finishValue(TK_FLOAT);
+    }
+}
+
+JsonReader::Token JsonReader::readKey(int ch)
+{
+    if (ch == '"')
+    {
+        if (!scanString(str_, length_))
+        {
+            return fail(RC_INVALID_STRING);
+        }
+    }
+    else if (ch == '-' || ch == '+' || (ch >= '0' && ch <= '9'))
+    {
+        str_ = cursor_ - 1;
+        if (!scanNumber(number_))
+        {
+            return fail(RC_INVALID_NUMBER);
+        }
+        if (!isInteger(number_))
+        {
+            return fail(RC_INVALID_KEY);
+        }
+        length_ = cursor_ - str_;
+    }
+    else
+    {
+        return fail(ch == 0 ? RC_END_OF_FILE : RC_INVALID_KEY);
+    }
+
+    state_ = S_COLON;
+    return token_ = TK_KEY;
+}
+
+bool JsonReader::skipValue()
+{
+    if (errorCode_ != RC_OK)
+    {
+        return false;
+    }
+
+    // 容器的结束符不属于任何值
+    if (state_ == S_FIRST || state_ == S_AFTER_VALUE)
+    {
+        int ch = aheadToken();
+        if (ch == '}' || ch == ']')
+        {
+            return false;
+        }
+    }
+
+    Token token = next();
+    if (token == TK_KEY)
+    {
+        token = next();
+    }
+
+    switch (token)
+    {
+    case TK_START_DICT:
+    case TK_START_ARRAY:
+        return skipContainer();
+    case TK_END:
+    case TK_END_DICT:
+    case TK_END_ARRAY:
+        return false;
+    default:
+        return true;
+    }
+}
+
+/** 刚读取了容器的起始符，直接扫描到匹配的结束符 */
+bool JsonReader::skipContainer()
+{
+    const char *p = cursor_;
+    int level = 1;
+    while (level > 0)
+    {
+        if (p == end_)
+        {
+            cursor_ = p;
+            fail(RC_END_OF_FILE);
+            return false;
+        }
+
+        char ch = *p++;
+        switch (ch)
+        {
+        case '{':
+        case '[':
+            ++level;
+            break;
+
+        case '}':
+        case ']':
+            --level;
+            break;
+
+        case '"':
+            while (true)
+            {
+                if (p == end_ || *p == '\n')
+                {
+                    cursor_ = p;
+                    fail(RC_INVALID_STRING);
+                    return false;
+                }
+                ch = *p++;
+                if (ch == '"')
+                {
+                    break;
+                }
+                if (ch == '\\' && p != end_)
+                {
+                    ++p;
+                }
+            }
+            break;
+
+        case '/':
+            if (p != end_ && *p == '/')
+            {
+                while (p != end_ && *p != '\n')
+                {
+                    ++p;
+                }
+            }
+            else if (p != end_ && *p == '*')
+            {
+                ++p;
+                while (true)
+                {
+                    if (end_ - p < 2)
+                    {
+                        cursor_ = p;
+                        fail(RC_INVALID_COMMENT);
+                        return false;
+                    }
+                    if (p[0] == '*' && p[1] == '/')
+                    {
+                        p += 2;
+                        break;
+                    }
+                    ++p;
+                }
+            }
+            else
+            {
+                cursor_ = p;
+                fail(RC_INVALID_COMMENT);
+                return false;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    cursor_ = p;
+
+    endContainer();
+    return true;
+}
+
+NS_SMARTJSON_END
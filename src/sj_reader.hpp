@@ -0,0 +1,130 @@
+﻿#pragma once
+#include "sj_parser.hpp"
+#include "sj_mapped_file.hpp"
+#include "sj_number.hpp"
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  拉取式(pull)的json读取器。
+ *  每次调用next()读取一个词法单元，不会创建任何节点，内存占用只与嵌套深度有关。
+ *  文件以内存映射的方式打开，操作系统按需加载页面，可以遍历超大的文件。
+ *  语法与Parser相同，支持注释和扩展的数字格式。
+ *
+ *  用法:
+ *  JsonReader reader;
+ *  reader.openFile("input.json");
+ *  for (JsonReader::Token t = reader.next(); t != JsonReader::TK_END; t = reader.next())
+ *  {
+ *      if (t == JsonReader::TK_KEY && !interested(reader.getString()))
+ *      {
+ *          reader.skipValue();
+ *      }
+ *  }
+ *  if (reader.getErrorCode() != RC_OK) ...
+ */
+class JsonReader : private Parser
+{
+    SJ_DISABLE_COPY_ASSIGN(JsonReader);
+public:
+    enum Token
+    {
+        /** 文档结束或者出错，使用getErrorCode()区分 */
+        TK_END,
+        TK_NULL,
+        TK_BOOL,
+        TK_INT,
+        TK_FLOAT,
+        TK_STRING,
+        /** 字典的key。key是整数时，getString()返回数字的原始文本，getInt()返回数值 */
+        TK_KEY,
+        TK_START_DICT,
+        TK_END_DICT,
+        TK_START_ARRAY,
+        TK_END_ARRAY,
+    };
+
+    JsonReader();
+
+    /** 以内存映射的方式打开文件 */
+    bool openFile(const char *fileName);
+    bool openFile(const std::string &fileName);
+
+    /** 读取内存中的数据，不会拷贝。读取期间data需要一直有效 */
+    bool open(const char *data, size_t length);
+
+    void close();
+
+    /** 读取下一个词法单元 */
+    Token next();
+
+    /** 跳过下一个值，下一个是字典的key时，跳过key和对应的值。
+     *  被跳过的容器只检查括号和字符串是否闭合，不会解析其中的内容。
+     *  下一个是容器的结束符时，什么也不做，返回false。
+     */
+    bool skipValue();
+
+    /** 当前所在容器的嵌套深度，根容器内为1 */
+    size_t depth() const { return stack_.size(); }
+
+    Token getToken() const { return token_; }
+
+    bool getBool() const { return bool_; }
+    Integer getInt() const { return (Integer)number_.integer; }
+    /** 整数的完整数值，不受SJ_USE_LARGE_NUMBER影响 */
+    int64_t getInt64() const { return number_.integer; }
+    /** TK_INT也可以作为浮点数读取 */
+    double getFloat() const { return number_.isFloat ? number_.real : (double)number_.integer; }
+
+    /** TK_STRING和TK_KEY的内容，在下一次调用next()之前有效，不保证以'\0'结尾 */
+    const char* getString() const { return str_; }
+    size_t getLength() const { return length_; }
+
+    /** 报告调用者发现的错误，例如数据绑定时类型不匹配。只保留最先发生的错误，之后next()总是返回TK_END */
+    void setError(int code) { fail(code); }
+
+    using IParser::getErrorCode;
+    using IParser::maxDepth_;
+    using Parser::getLine;
+    using Parser::getColumn;
+    using Parser::getErrorOffset;
+
+private:
+    enum State
+    {
+        /** 等待根节点 */
+        S_ROOT,
+        /** 刚读取了'{'或'['，容器可能为空 */
+        S_FIRST,
+        /** 读取了字典中的','，等待key */
+        S_KEY,
+        /** 读取了key，等待':'和值 */
+        S_COLON,
+        /** 读取了数组中的','，等待值 */
+        S_VALUE,
+        /** 读取了一个值，等待','或容器结束符 */
+        S_AFTER_VALUE,
+        /** 根节点读取完毕 */
+        S_DONE,
+    };
+
+    int readToken();
+    Token readValue(int ch);
+    Token readKey(int ch);
+    Token startContainer(char ch);
+    Token endContainer();
+    Token finishValue(Token token);
+    Token fail(int code);
+    bool skipContainer();
+
+    MappedFile      file_;
+    std::vector<char> stack_;
+    State           state_ = S_DONE;
+    Token           token_ = TK_END;
+    bool            bool_ = false;
+    NumberResult    number_;
+    const char*     str_ = nullptr;
+    size_t          length_ = 0;
+};
+
+NS_SMARTJSON_END
@@ -0,0 +1,158 @@
+﻿#pragma once
+#include "sj_cpu.hpp"
+
+#include <cstdint>
+
+/**
+ *  SIMD函数的内部定义，只在实现文件中使用。
+ *  开启SJ_USE_CPU_DISPATCH时，x86平台会编译所有指令集的版本，使用函数属性开启对应的指令集；
+ *  否则只编译编译选项开启的版本。
+ */
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   define SJ_SIMD_X86 1
+#   include <immintrin.h>
+#   if SJ_USE_CPU_DISPATCH
+#       define SJ_SIMD_SSE2 1
+#       define SJ_SIMD_AVX2 1
+#       define SJ_SIMD_AVX512 1
+#   else
+#       if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#           define SJ_SIMD_SSE2 1
+#       endif
+#       if defined(__AVX2__)
+#           define SJ_SIMD_AVX2 1
+#       endif
+#       if defined(__AVX512F__) && defined(__AVX512BW__)
+#           define SJ_SIMD_AVX512 1
+#       endif
+#   endif
+#   if defined(__PCLMUL__)
+#       include <wmmintrin.h>
+#   endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#   include <arm_neon.h>
+#   define SJ_SIMD_NEON 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#   include <intrin.h>
+#   define SJ_TARGET(ISA)
+#elif SJ_SIMD_X86
+#   define SJ_TARGET(ISA) __attribute__((target(ISA)))
+#else
+#   define SJ_TARGET(ISA)
+#endif
+
+NS_SMARTJSON_BEGIN
+
+/** 一个64字节分块中各类字符的位图，第i位对应第i个字节 */
+struct BlockMasks
+{
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;
+    uint64_t whitespace;
+    uint64_t slash;
+};
+
+/** 运行时选择的SIMD函数 */
+struct SimdKernels
+{
+    /** 实际使用的指令集 */
+    unsigned features;
+
+    const char* (*findStringSpecial)(const char *p, const char *end);
+    const char* (*findEscapeChar)(const char *p, const char *end);
+    const char* (*validateUTF8)(const char *begin, const char *end);
+    void (*classifyBlock)(const uint8_t *p, BlockMasks &masks);
+};
+
+const SimdKernels& getSimdKernels();
+
+/** 各模块按指令集绑定自己的函数，features只包含CPU支持的指令集 */
+void bindStringScanKernels(SimdKernels &kernels, unsigned features);
+void bindUTF8Kernels(SimdKernels &kernels, unsigned features);
+void bindStructuralIndexKernels(SimdKernels &kernels, unsigned features);
+
+inline int trailingZeros32(uint32_t v)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, v);
+    return (int)index;
+#else
+    return __builtin_ctz(v);
+#endif
+}
+
+inline int trailingZeros64(uint64_t v)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, v);
+    return (int)index;
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+/** 前缀异或：第i位的结果，是输入中第0位到第i位的异或 */
+inline uint64_t prefixXor(uint64_t v)
+{
+#if defined(__PCLMUL__)
+    __m128i all = _mm_set1_epi8((char)0xff);
+    __m128i r = _mm_clmulepi64_si128(_mm_set_epi64x(0, (long long)v), all, 0);
+    return (uint64_t)_mm_cvtsi128_si64(r);
+#else
+    v ^= v << 1;
+    v ^= v << 2;
+    v ^= v << 4;
+    v ^= v << 8;
+    v ^= v << 16;
+    v ^= v << 32;
+    return v;
+#endif
+}
+
+/** 跨分块的扫描状态 */
+struct ScanState
+{
+    /** 上一个分块的最后一个字符是未结束的转义符 */
+    uint64_t escapeCarry = 0;
+    /** 上一个分块结束时是否在字符串内，全1或全0 */
+    uint64_t inString = 0;
+    /** 上一个分块的最后一个字符是否是标量字符 */
+    uint64_t scalarCarry = 0;
+};
+
+/** 找出被转义的字符。连续的'\\'中，奇数位置的'\\'会转义它后面的字符 */
+inline uint64_t findEscaped(uint64_t backslash, ScanState &state)
+{
+    const uint64_t evenBits = 0x5555555555555555ULL;
+
+    // 如果第一个字符已经被转义了，它就不能再作为转义符
+    backslash &= ~state.escapeCarry;
+    uint64_t followsEscape = (backslash << 1) | state.escapeCarry;
+
+    // 利用加法的进位，清除从奇数位开始的'\\'序列
+    uint64_t oddStarts = backslash & ~evenBits & ~followsEscape;
+    uint64_t evenStarts = oddStarts + backslash;
+    state.escapeCarry = evenStarts < oddStarts ? 1 : 0;
+
+    uint64_t invertMask = evenStarts << 1;
+    return (evenBits ^ invertMask) & followsEscape;
+}
+
+/** 计算字符串的范围，包含起始引号，不包含结束引号。quote返回未被转义的引号 */
+inline uint64_t findStrings(const BlockMasks &m, ScanState &state, uint64_t &quote)
+{
+    uint64_t escaped = findEscaped(m.backslash, state);
+    quote = m.quote & ~escaped;
+
+    uint64_t inString = prefixXor(quote) ^ state.inString;
+    state.inString = (uint64_t)((int64_t)inString >> 63);
+    return inString;
+}
+
+NS_SMARTJSON_END
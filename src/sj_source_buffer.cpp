@@ -0,0 +1,52 @@
+﻿#include "sj_source_buffer.hpp"
+
+NS_SMARTJSON_BEGIN
+
+SourceBuffer::~SourceBuffer()
+{
+    if (ownData_)
+    {
+        delete [] data_;
+    }
+}
+
+/*static*/ SourceBuffer* SourceBuffer::create(size_t size)
+{
+    SourceBuffer *ret = new SourceBuffer();
+    // 多分配一个字节，保证数据总是以'\0'结尾
+    ret->data_ = new char[size + 1];
+    ret->data_[size] = 0;
+    ret->size_ = size;
+    ret->ownData_ = true;
+    return ret;
+}
+
+/*static*/ SourceBuffer* SourceBuffer::createFromData(const char *data, size_t size)
+{
+    SourceBuffer *ret = create(size);
+    memcpy(ret->data_, data, size);
+    return ret;
+}
+
+/*static*/ SourceBuffer* SourceBuffer::createFromFile(const char *fileName)
+{
+    SourceBuffer *ret = new SourceBuffer();
+    if (!ret->file_.open(fileName, true, true))
+    {
+        delete ret;
+        return nullptr;
+    }
+    ret->data_ = ret->file_.mutableData();
+    ret->size_ = ret->file_.size();
+    return ret;
+}
+
+/*static*/ SourceBuffer* SourceBuffer::createWithMemory(char *data, size_t size)
+{
+    SourceBuffer *ret = new SourceBuffer();
+    ret->data_ = data;
+    ret->size_ = size;
+    return ret;
+}
+
+NS_SMARTJSON_END
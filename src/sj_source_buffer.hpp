@@ -0,0 +1,42 @@
+﻿#pragma once
+#include "sj_node.hpp"
+#include "sj_mapped_file.hpp"
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  引用计数的输入数据缓冲区。
+ *  原地解析(in-situ)时，字符串节点直接引用缓冲区中的数据，并持有缓冲区的引用计数。
+ *  所有引用它的字符串都释放后，缓冲区才会被销毁。
+ *  注意：原地解析会修改缓冲区的内容。
+ */
+class SourceBuffer : public IRefCout
+{
+    SJ_DISABLE_COPY_ASSIGN(SourceBuffer);
+public:
+    /** 分配一块可写的缓冲区，由调用者填充数据 */
+    static SourceBuffer* create(size_t size);
+
+    /** 拷贝一份数据 */
+    static SourceBuffer* createFromData(const char *data, size_t size);
+
+    /** 以写时复制的方式映射文件，修改不会写回到文件中。失败返回nullptr */
+    static SourceBuffer* createFromFile(const char *fileName);
+
+    /** 直接使用调用者的内存，不会释放它。调用者需要保证内存比所有节点的生命周期都长 */
+    static SourceBuffer* createWithMemory(char *data, size_t size);
+
+    char* data() { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    SourceBuffer() = default;
+    ~SourceBuffer();
+
+    char*           data_ = nullptr;
+    size_t          size_ = 0;
+    bool            ownData_ = false;
+    MappedFile      file_;
+};
+
+NS_SMARTJSON_END
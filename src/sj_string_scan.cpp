@@ -0,0 +1,314 @@
+﻿#include "sj_string_scan.hpp"
+#include "sj_simd.hpp"
+
+#include <cstring>
+
+NS_SMARTJSON_BEGIN
+
+namespace
+{
+    const uint64_t ONES = 0x0101010101010101ull;
+    const uint64_t HIGHS = 0x8080808080808080ull;
+
+    /** 8个字节中是否有等于c的字节 */
+    inline bool hasByte(uint64_t v, uint8_t c)
+    {
+        uint64_t x = v ^ (ONES * c);
+        return ((x - ONES) & ~x & HIGHS) != 0;
+    }
+
+    /** 8个字节中是否有小于0x20的字节 */
+    inline bool hasControl(uint64_t v)
+    {
+        return ((v - ONES * 0x20) & ~v & HIGHS) != 0;
+    }
+
+    inline bool isStringSpecial(char ch)
+    {
+        return ch == '"' || ch == '\\' || ch == '\n' || ch == '\0';
+    }
+
+    inline bool isEscapeCandidate(char ch)
+    {
+        return (uint8_t)ch < 0x20 || ch == '"' || ch == '\\';
+    }
+
+    ///////////////////////////////////////////////////////////////////
+    // 标量实现，也用于处理SIMD版本剩下的不足一个向量的数据
+    ///////////////////////////////////////////////////////////////////
+
+    const char* findStringSpecialScalar(const char *p, const char *end)
+    {
+        for (; end - p >= 8; p += 8)
+        {
+            uint64_t v;
+            memcpy(&v, p, 8);
+            if (hasByte(v, '"') || hasByte(v, '\\') || hasByte(v, '\n') || hasByte(v, 0))
+            {
+                break;
+            }
+        }
+        while (p != end && !isStringSpecial(*p))
+        {
+            ++p;
+        }
+        return p;
+    }
+
+    const char* findEscapeCharScalar(const char *p, const char *end)
+    {
+        for (; end - p >= 8; p += 8)
+        {
+            uint64_t v;
+            memcpy(&v, p, 8);
+            if (hasControl(v) || hasByte(v, '"') || hasByte(v, '\\'))
+            {
+                break;
+            }
+        }
+        while (p != end && !isEscapeCandidate(*p))
+        {
+            ++p;
+        }
+        return p;
+    }
+
+#if SJ_SIMD_SSE2
+
+    SJ_TARGET("sse2") const char* findStringSpecialSSE2(const char *p, const char *end)
+    {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i newline = _mm_set1_epi8('\n');
+        const __m128i zero = _mm_setzero_si128();
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i m = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                _mm_or_si128(_mm_cmpeq_epi8(v, newline), _mm_cmpeq_epi8(v, zero)));
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(m);
+            if (mask != 0)
+            {
+                return p + trailingZeros32(mask);
+            }
+        }
+        return findStringSpecialScalar(p, end);
+    }
+
+    SJ_TARGET("sse2") const char* findEscapeCharSSE2(const char *p, const char *end)
+    {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1f);
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            // 无符号比较：v <= 0x1f 等价于 min(v, 0x1f) == v
+            __m128i m = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(m);
+            if (mask != 0)
+            {
+                return p + trailingZeros32(mask);
+            }
+        }
+        return findEscapeCharScalar(p, end);
+    }
+
+#endif
+
+#if SJ_SIMD_AVX2
+
+    SJ_TARGET("avx2") const char* findStringSpecialAVX2(const char *p, const char *end)
+    {
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        const __m256i newline = _mm256_set1_epi8('\n');
+        const __m256i zero = _mm256_setzero_si256();
+        for (; end - p >= 32; p += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i m = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, newline), _mm256_cmpeq_epi8(v, zero)));
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(m);
+            if (mask != 0)
+            {
+                return p + trailingZeros32(mask);
+            }
+        }
+        // 剩下的字节先用SSE2检查16个字节
+        return findStringSpecialSSE2(p, end);
+    }
+
+    SJ_TARGET("avx2") const char* findEscapeCharAVX2(const char *p, const char *end)
+    {
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        const __m256i control = _mm256_set1_epi8(0x1f);
+        for (; end - p >= 32; p += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i m = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                _mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v));
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(m);
+            if (mask != 0)
+            {
+                return p + trailingZeros32(mask);
+            }
+        }
+        return findEscapeCharSSE2(p, end);
+    }
+
+#endif
+
+#if SJ_SIMD_AVX512
+
+    SJ_TARGET("avx512f,avx512bw") const char* findStringSpecialAVX512(const char *p, const char *end)
+    {
+        const __m512i quote = _mm512_set1_epi8('"');
+        const __m512i backslash = _mm512_set1_epi8('\\');
+        const __m512i newline = _mm512_set1_epi8('\n');
+        for (; end - p >= 64; p += 64)
+        {
+            __m512i v = _mm512_loadu_si512(p);
+            uint64_t mask = _mm512_cmpeq_epi8_mask(v, quote) | _mm512_cmpeq_epi8_mask(v, backslash) |
+                _mm512_cmpeq_epi8_mask(v, newline) | _mm512_testn_epi8_mask(v, v);
+            if (mask != 0)
+            {
+                return p + trailingZeros64(mask);
+            }
+        }
+
+        // 剩下的字节使用掩码读取，不会越界访问
+        if (p == end)
+        {
+            return end;
+        }
+        uint64_t valid = (~0ull) >> (64 - (end - p));
+        __m512i v = _mm512_maskz_loadu_epi8(valid, p);
+        uint64_t mask = _mm512_mask_cmpeq_epi8_mask(valid, v, quote) | _mm512_mask_cmpeq_epi8_mask(valid, v, backslash) |
+            _mm512_mask_cmpeq_epi8_mask(valid, v, newline) | _mm512_mask_testn_epi8_mask(valid, v, v);
+        return mask != 0 ? p + trailingZeros64(mask) : end;
+    }
+
+    SJ_TARGET("avx512f,avx512bw") const char* findEscapeCharAVX512(const char *p, const char *end)
+    {
+        const __m512i quote = _mm512_set1_epi8('"');
+        const __m512i backslash = _mm512_set1_epi8('\\');
+        const __m512i control = _mm512_set1_epi8(0x20);
+        for (; end - p >= 64; p += 64)
+        {
+            __m512i v = _mm512_loadu_si512(p);
+            uint64_t mask = _mm512_cmpeq_epi8_mask(v, quote) | _mm512_cmpeq_epi8_mask(v, backslash) |
+                _mm512_cmplt_epu8_mask(v, control);
+            if (mask != 0)
+            {
+                return p + trailingZeros64(mask);
+            }
+        }
+
+        if (p == end)
+        {
+            return end;
+        }
+        uint64_t valid = (~0ull) >> (64 - (end - p));
+        __m512i v = _mm512_maskz_loadu_epi8(valid, p);
+        uint64_t mask = _mm512_mask_cmpeq_epi8_mask(valid, v, quote) | _mm512_mask_cmpeq_epi8_mask(valid, v, backslash) |
+            _mm512_mask_cmplt_epu8_mask(valid, v, control);
+        return mask != 0 ? p + trailingZeros64(mask) : end;
+    }
+
+#endif
+
+#if SJ_SIMD_NEON
+
+    const char* findStringSpecialNEON(const char *p, const char *end)
+    {
+        const uint8x16_t quote = vdupq_n_u8('"');
+        const uint8x16_t backslash = vdupq_n_u8('\\');
+        const uint8x16_t newline = vdupq_n_u8('\n');
+        for (; end - p >= 16; p += 16)
+        {
+            uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+            uint8x16_t m = vorrq_u8(
+                vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)),
+                vorrq_u8(vceqq_u8(v, newline), vceqzq_u8(v)));
+            if (vmaxvq_u8(m) != 0)
+            {
+                break;
+            }
+        }
+        return findStringSpecialScalar(p, end);
+    }
+
+    const char* findEscapeCharNEON(const char *p, const char *end)
+    {
+        const uint8x16_t quote = vdupq_n_u8('"');
+        const uint8x16_t backslash = vdupq_n_u8('\\');
+        const uint8x16_t control = vdupq_n_u8(0x20);
+        for (; end - p >= 16; p += 16)
+        {
+            uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+            uint8x16_t m = vorrq_u8(
+                vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)),
+                vcltq_u8(v, control));
+            if (vmaxvq_u8(m) != 0)
+            {
+                break;
+            }
+        }
+        return findEscapeCharScalar(p, end);
+    }
+
+#endif
+}
+
+void bindStringScanKernels(SimdKernels &kernels, unsigned features)
+{
+    kernels.findStringSpecial = findStringSpecialScalar;
+    kernels.findEscapeChar = findEscapeCharScalar;
+#if SJ_SIMD_SSE2
+    if (features & CPU_SSE2)
+    {
+        kernels.findStringSpecial = findStringSpecialSSE2;
+        kernels.findEscapeChar = findEscapeCharSSE2;
+    }
+#endif
+#if SJ_SIMD_AVX2
+    if (features & CPU_AVX2)
+    {
+        kernels.findStringSpecial = findStringSpecialAVX2;
+        kernels.findEscapeChar = findEscapeCharAVX2;
+    }
+#endif
+#if SJ_SIMD_AVX512
+    if (features & CPU_AVX512)
+    {
+        kernels.findStringSpecial = findStringSpecialAVX512;
+        kernels.findEscapeChar = findEscapeCharAVX512;
+    }
+#endif
+#if SJ_SIMD_NEON
+    if (features & CPU_NEON)
+    {
+        kernels.findStringSpecial = findStringSpecialNEON;
+        kernels.findEscapeChar = findEscapeCharNEON;
+    }
+#endif
+}
+
+const char* findStringSpecial(const char *p, const char *end)
+{
+    return getSimdKernels().findStringSpecial(p, end);
+}
+
+const char* findEscapeChar(const char *p, const char *end)
+{
+    return getSimdKernels().findEscapeChar(p, end);
+}
+
+NS_SMARTJSON_END
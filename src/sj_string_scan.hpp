@@ -0,0 +1,21 @@
+﻿#pragma once
+#include "sj_config.hpp"
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  查找字符串中下一个需要特殊处理的字符：引号、反斜杠、换行符或'\0'。
+ *  使用SIMD指令(AVX-512/AVX2/SSE2/NEON，运行时选择，不支持时每次检查8个字节)一次检查16~64个字节，
+ *  解析器可以直接拷贝中间不包含特殊字符的片段。
+ *  @return 第一个特殊字符的位置；没有找到时返回end。
+ */
+const char* findStringSpecial(const char *p, const char *end);
+
+/**
+ *  查找下一个可能需要转义的字符：控制字符(小于0x20)、引号或反斜杠。
+ *  Writer直接输出中间的片段，只对找到的字符逐个处理。
+ *  @return 第一个可能需要转义的字符的位置；没有找到时返回end。
+ */
+const char* findEscapeChar(const char *p, const char *end);
+
+NS_SMARTJSON_END
@@ -0,0 +1,304 @@
+﻿#include "sj_structural_index.hpp"
+#include "sj_simd.hpp"
+
+#include <cstring>
+
+NS_SMARTJSON_BEGIN
+
+namespace
+{
+    inline int trailingZeros(uint64_t v)
+    {
+        return trailingZeros64(v);
+    }
+
+    enum CharClass
+    {
+        CC_QUOTE = 1,
+        CC_BACKSLASH = 2,
+        CC_OP = 4,
+        CC_SPACE = 8,
+        CC_SLASH = 16,
+    };
+
+    struct CharClassTable
+    {
+        uint8_t table[256];
+
+        CharClassTable()
+        {
+            memset(table, 0, sizeof(table));
+            table[(uint8_t)'"'] = CC_QUOTE;
+            table[(uint8_t)'\\'] = CC_BACKSLASH;
+            const char *ops = "{}[]:,";
+            for (const char *p = ops; *p; ++p)
+            {
+                table[(uint8_t)*p] = CC_OP;
+            }
+            const char *spaces = " \t\r\n";
+            for (const char *p = spaces; *p; ++p)
+            {
+                table[(uint8_t)*p] = CC_SPACE;
+            }
+            table[(uint8_t)'/'] = CC_SLASH;
+        }
+    };
+
+    const CharClassTable s_charClass;
+
+    void classifyScalar(const uint8_t *p, BlockMasks &m)
+    {
+        m.quote = m.backslash = m.op = m.whitespace = m.slash = 0;
+        for (size_t i = 0; i < StructuralIndex::BLOCK_SIZE; ++i)
+        {
+            uint64_t bit = (uint64_t)1 << i;
+            switch (s_charClass.table[p[i]])
+            {
+            case CC_QUOTE: m.quote |= bit; break;
+            case CC_BACKSLASH: m.backslash |= bit; break;
+            case CC_OP: m.op |= bit; break;
+            case CC_SPACE: m.whitespace |= bit; break;
+            case CC_SLASH: m.slash |= bit; break;
+            default: break;
+            }
+        }
+    }
+
+#if SJ_SIMD_AVX512
+
+    SJ_TARGET("avx512f,avx512bw") void classifyAVX512(const uint8_t *p, BlockMasks &m)
+    {
+        __m512i v = _mm512_loadu_si512(p);
+        // '[' | 0x20 = '{', ']' | 0x20 = '}'
+        __m512i lower = _mm512_or_si512(v, _mm512_set1_epi8(0x20));
+        m.quote = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('"'));
+        m.backslash = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\\'));
+        m.op = _mm512_cmpeq_epi8_mask(lower, _mm512_set1_epi8('{')) | _mm512_cmpeq_epi8_mask(lower, _mm512_set1_epi8('}')) |
+            _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(':')) | _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(','));
+        m.whitespace = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8(' ')) | _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\t')) |
+            _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\n')) | _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('\r'));
+        m.slash = _mm512_cmpeq_epi8_mask(v, _mm512_set1_epi8('/'));
+    }
+
+#endif
+
+#if SJ_SIMD_AVX2
+
+    SJ_TARGET("avx2") inline uint64_t mask32(__m256i eq)
+    {
+        return (uint32_t)_mm256_movemask_epi8(eq);
+    }
+
+    SJ_TARGET("avx2") void classifyAVX2(const uint8_t *p, BlockMasks &m)
+    {
+        m.quote = m.backslash = m.op = m.whitespace = m.slash = 0;
+        for (int k = 0; k < 2; ++k)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + k * 32));
+            // '[' | 0x20 = '{', ']' | 0x20 = '}'
+            __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+            __m256i op = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+            __m256i space = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+
+            int shift = k * 32;
+            m.quote |= mask32(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))) << shift;
+            m.backslash |= mask32(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))) << shift;
+            m.op |= mask32(op) << shift;
+            m.whitespace |= mask32(space) << shift;
+            m.slash |= mask32(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('/'))) << shift;
+        }
+    }
+
+#endif
+
+#if SJ_SIMD_SSE2
+
+    SJ_TARGET("sse2") inline uint64_t mask16(__m128i eq)
+    {
+        return (uint32_t)_mm_movemask_epi8(eq);
+    }
+
+    SJ_TARGET("sse2") void classifySSE2(const uint8_t *p, BlockMasks &m)
+    {
+        m.quote = m.backslash = m.op = m.whitespace = m.slash = 0;
+        for (int k = 0; k < 4; ++k)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + k * 16));
+            // '[' | 0x20 = '{', ']' | 0x20 = '}'
+            __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+            __m128i op = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(lower, _mm_set1_epi8('{')), _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'))),
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+            __m128i space = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+
+            int shift = k * 16;
+            m.quote |= mask16(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << shift;
+            m.backslash |= mask16(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << shift;
+            m.op |= mask16(op) << shift;
+            m.whitespace |= mask16(space) << shift;
+            m.slash |= mask16(_mm_cmpeq_epi8(v, _mm_set1_epi8('/'))) << shift;
+        }
+    }
+
+#endif
+
+    inline uint64_t scanBlock(const BlockMasks &m, ScanState &state)
+    {
+        uint64_t quote;
+        uint64_t inString = findStrings(m, state, quote);
+
+        uint64_t op = m.op & ~inString;
+        uint64_t openQuote = quote & inString;
+
+        // 标量是字符串外，非空白、非结构字符的连续字符序列，只记录它的起始位置
+        uint64_t scalar = ~(m.op | m.whitespace | quote | inString);
+        uint64_t scalarStart = scalar & ~((scalar << 1) | state.scalarCarry);
+        state.scalarCarry = scalar >> 63;
+
+        return op | openQuote | scalarStart;
+    }
+
+    inline void flatten(std::vector<uint32_t> &indices, uint32_t base, uint64_t bits)
+    {
+        while (bits != 0)
+        {
+            indices.push_back(base + (uint32_t)trailingZeros(bits));
+            bits &= bits - 1;
+        }
+    }
+}
+
+void bindStructuralIndexKernels(SimdKernels &kernels, unsigned features)
+{
+    kernels.classifyBlock = classifyScalar;
+#if SJ_SIMD_SSE2
+    if (features & CPU_SSE2)
+    {
+        kernels.classifyBlock = classifySSE2;
+    }
+#endif
+#if SJ_SIMD_AVX2
+    if (features & CPU_AVX2)
+    {
+        kernels.classifyBlock = classifyAVX2;
+    }
+#endif
+#if SJ_SIMD_AVX512
+    if (features & CPU_AVX512)
+    {
+        kernels.classifyBlock = classifyAVX512;
+    }
+#endif
+}
+
+bool StructuralIndex::build(const char *data, size_t length)
+{
+    indices_.clear();
+    if (length > MAX_LENGTH)
+    {
+        return false;
+    }
+
+    // 预估结构字符的数量，减少扩容
+    indices_.reserve(length / 8 + 16);
+
+    const uint8_t *p = reinterpret_cast<const uint8_t*>(data);
+    ScanState state;
+    BlockMasks masks;
+    void (*classify)(const uint8_t*, BlockMasks&) = getSimdKernels().classifyBlock;
+
+    size_t offset = 0;
+    for (; offset + BLOCK_SIZE <= length; offset += BLOCK_SIZE)
+    {
+        classify(p + offset, masks);
+        flatten(indices_, (uint32_t)offset, scanBlock(masks, state));
+    }
+
+    if (offset < length)
+    {
+        // 最后不足一个分块的部分，使用空白字符补齐
+        uint8_t tail[BLOCK_SIZE];
+        memset(tail, ' ', BLOCK_SIZE);
+        memcpy(tail, p + offset, length - offset);
+
+        classify(tail, masks);
+        flatten(indices_, (uint32_t)offset, scanBlock(masks, state));
+    }
+
+    return state.inString == 0;
+}
+
+bool StructuralIndex::findSplitPoints(const char *data, size_t length, size_t chunkSize, std::vector<size_t> &splits)
+{
+    splits.clear();
+
+    const uint8_t *p = reinterpret_cast<const uint8_t*>(data);
+    ScanState state;
+    BlockMasks masks;
+    uint8_t tail[BLOCK_SIZE];
+    void (*classify)(const uint8_t*, BlockMasks&) = getSimdKernels().classifyBlock;
+
+    int depth = 0;
+    size_t nextSplit = chunkSize;
+    for (size_t offset = 0; offset < length; offset += BLOCK_SIZE)
+    {
+        const uint8_t *block = p + offset;
+        if (offset + BLOCK_SIZE > length)
+        {
+            memset(tail, ' ', BLOCK_SIZE);
+            memcpy(tail, block, length - offset);
+            block = tail;
+        }
+
+        classify(block, masks);
+        uint64_t quote;
+        uint64_t inString = findStrings(masks, state, quote);
+
+        // 注释中的引号和括号会影响判断，交给调用者按顺序解析
+        if ((masks.slash & ~inString) != 0)
+        {
+            return false;
+        }
+
+        uint64_t op = masks.op & ~inString;
+        while (op != 0)
+        {
+            int i = trailingZeros(op);
+            op &= op - 1;
+
+            switch (block[i])
+            {
+            case '{':
+            case '[':
+                ++depth;
+                break;
+            case '}':
+            case ']':
+                if (--depth < 0)
+                {
+                    return false;
+                }
+                break;
+            case ',':
+                if (depth == 1 && offset + i >= nextSplit)
+                {
+                    splits.push_back(offset + i);
+                    nextSplit = offset + i + chunkSize;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    return state.inString == 0 && depth == 0;
+}
+
+NS_SMARTJSON_END
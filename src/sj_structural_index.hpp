@@ -0,0 +1,49 @@
+﻿#pragma once
+#include "sj_config.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  结构字符索引，两阶段解析的第一阶段。
+ *  将输入数据按64字节分块，使用SIMD指令(AVX-512/AVX2/SSE2，运行时选择，不支持时使用标量代码)对字节分类，
+ *  得到引号、转义符、结构字符和空白字符的位图，再计算出字符串的范围，
+ *  最终记录所有字符串外的结构字符 `{}[]:,`、字符串的起始引号和标量(数字、true、false、null)的起始位置。
+ *  注意：不支持注释。
+ */
+class StructuralIndex
+{
+public:
+    /** 每个分块的字节数 */
+    static const size_t BLOCK_SIZE = 64;
+
+    /** 输入数据的最大长度。索引使用32位整数存储 */
+    static const size_t MAX_LENGTH = 0xffffffffu;
+
+    StructuralIndex() = default;
+
+    /** 构建索引。如果有未闭合的字符串，返回false */
+    bool build(const char *data, size_t length);
+
+    /**
+     *  找出根容器中可以切分的位置，用于并行解析。
+     *  每隔至少chunkSize字节，记录一个深度为1的','的位置。
+     *  字符串没有闭合、括号不匹配或者字符串外出现了'/'(注释)时，返回false。
+     */
+    static bool findSplitPoints(const char *data, size_t length, size_t chunkSize, std::vector<size_t> &splits);
+
+    void clear() { indices_.clear(); }
+
+    size_t size() const { return indices_.size(); }
+    uint32_t operator[] (size_t i) const { return indices_[i]; }
+
+    const std::vector<uint32_t>& indices() const { return indices_; }
+
+private:
+    std::vector<uint32_t> indices_;
+};
+
+NS_SMARTJSON_END
@@ -0,0 +1,57 @@
+﻿#include "sj_thread_pool.hpp"
+
+NS_SMARTJSON_BEGIN
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::thread::hardware_concurrency();
+        if (threadCount == 0)
+        {
+            threadCount = 1;
+        }
+    }
+
+    threads_.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        threads_.emplace_back(&ThreadPool::run, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_all();
+
+    for (std::thread &thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::run()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+            // 退出前执行完剩余的任务
+            if (tasks_.empty())
+            {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop();
+        }
+        task();
+    }
+}
+
+NS_SMARTJSON_END
@@ -0,0 +1,55 @@
+﻿#pragma once
+#include "sj_config.hpp"
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  固定线程数的线程池，供并行解析使用。
+ *  注意：Node和IAllocator的引用计数不是线程安全的，
+ *  任务之间不能共享节点和分配器，任务的结果需要等future完成后再使用。
+ */
+class ThreadPool
+{
+    SJ_DISABLE_COPY_ASSIGN(ThreadPool);
+public:
+    /** threadCount为0时，使用硬件支持的并发线程数 */
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    size_t size() const { return threads_.size(); }
+
+    template<typename F>
+    auto submit(F func) -> std::future<decltype(func())>
+    {
+        typedef decltype(func()) ResultType;
+        // std::function要求可以拷贝，因此用shared_ptr包装packaged_task
+        auto task = std::make_shared<std::packaged_task<ResultType()>>(std::move(func));
+        std::future<ResultType> future = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push([task]() { (*task)(); });
+        }
+        condition_.notify_one();
+        return future;
+    }
+
+private:
+    void run();
+
+    std::vector<std::thread> threads_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex      mutex_;
+    std::condition_variable condition_;
+    bool            stop_ = false;
+};
+
+NS_SMARTJSON_END
@@ -0,0 +1,237 @@
+﻿#include "sj_utf8.hpp"
+#include "sj_simd.hpp"
+
+#include <cstring>
+
+NS_SMARTJSON_BEGIN
+
+namespace
+{
+    /** 跳过开头的ASCII字符，返回第一个非ASCII字符的位置，或者end。每次检查8个字节 */
+    inline const uint8_t* skipASCII(const uint8_t *p, const uint8_t *end)
+    {
+        for (; end - p >= 8; p += 8)
+        {
+            uint64_t v;
+            memcpy(&v, p, 8);
+            if ((v & 0x8080808080808080ull) != 0)
+            {
+                break;
+            }
+        }
+        while (p != end && *p < 0x80)
+        {
+            ++p;
+        }
+        return p;
+    }
+
+    /** 检查以p开头的一个多字节序列，返回序列的长度，非法时返回0 */
+    inline size_t checkSequence(const uint8_t *p, const uint8_t *end)
+    {
+        uint8_t lead = p[0];
+        size_t length;
+        // 第二个字节的合法范围，用于排除过长编码、代理区和超过U+10FFFF的码点
+        uint8_t low = 0x80, high = 0xBF;
+        if (lead >= 0xC2 && lead <= 0xDF)
+        {
+            length = 2;
+        }
+        else if (lead >= 0xE0 && lead <= 0xEF)
+        {
+            length = 3;
+            if (lead == 0xE0)
+            {
+                low = 0xA0;
+            }
+            else if (lead == 0xED)
+            {
+                high = 0x9F;
+            }
+        }
+        else if (lead >= 0xF0 && lead <= 0xF4)
+        {
+            length = 4;
+            if (lead == 0xF0)
+            {
+                low = 0x90;
+            }
+            else if (lead == 0xF4)
+            {
+                high = 0x8F;
+            }
+        }
+        else
+        {
+            return 0;
+        }
+
+        if ((size_t)(end - p) < length || p[1] < low || p[1] > high)
+        {
+            return 0;
+        }
+        for (size_t i = 2; i < length; ++i)
+        {
+            if ((p[i] & 0xC0) != 0x80)
+            {
+                return 0;
+            }
+        }
+        return length;
+    }
+
+    /** skip跳过开头的ASCII字符，多字节序列使用标量代码检查 */
+    template<const uint8_t* (*Skip)(const uint8_t*, const uint8_t*)>
+    inline const char* validate(const char *begin, const char *end)
+    {
+        const uint8_t *p = reinterpret_cast<const uint8_t*>(begin);
+        const uint8_t *last = reinterpret_cast<const uint8_t*>(end);
+        while (true)
+        {
+            p = Skip(p, last);
+            if (p == last)
+            {
+                return nullptr;
+            }
+
+            // 逐个检查连续的多字节序列，直到再次遇到ASCII字符
+            do
+            {
+                size_t length = checkSequence(p, last);
+                if (length == 0)
+                {
+                    return reinterpret_cast<const char*>(p);
+                }
+                p += length;
+            } while (p != last && *p >= 0x80);
+        }
+    }
+
+    const char* validateScalar(const char *begin, const char *end)
+    {
+        return validate<skipASCII>(begin, end);
+    }
+
+#if SJ_SIMD_SSE2
+
+    SJ_TARGET("sse2") inline const uint8_t* skipASCIISSE2(const uint8_t *p, const uint8_t *end)
+    {
+        for (; end - p >= 16; p += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            if (_mm_movemask_epi8(v) != 0)
+            {
+                break;
+            }
+        }
+        return skipASCII(p, end);
+    }
+
+    SJ_TARGET("sse2") const char* validateSSE2(const char *begin, const char *end)
+    {
+        return validate<skipASCIISSE2>(begin, end);
+    }
+
+#endif
+
+#if SJ_SIMD_AVX2
+
+    SJ_TARGET("avx2") inline const uint8_t* skipASCIIAVX2(const uint8_t *p, const uint8_t *end)
+    {
+        for (; end - p >= 32; p += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            if (_mm256_movemask_epi8(v) != 0)
+            {
+                break;
+            }
+        }
+        return skipASCII(p, end);
+    }
+
+    SJ_TARGET("avx2") const char* validateAVX2(const char *begin, const char *end)
+    {
+        return validate<skipASCIIAVX2>(begin, end);
+    }
+
+#endif
+
+#if SJ_SIMD_AVX512
+
+    SJ_TARGET("avx512f,avx512bw") inline const uint8_t* skipASCIIAVX512(const uint8_t *p, const uint8_t *end)
+    {
+        for (; end - p >= 64; p += 64)
+        {
+            __m512i v = _mm512_loadu_si512(p);
+            if (_mm512_movepi8_mask(v) != 0)
+            {
+                break;
+            }
+        }
+        return skipASCII(p, end);
+    }
+
+    SJ_TARGET("avx512f,avx512bw") const char* validateAVX512(const char *begin, const char *end)
+    {
+        return validate<skipASCIIAVX512>(begin, end);
+    }
+
+#endif
+
+#if SJ_SIMD_NEON
+
+    inline const uint8_t* skipASCIINEON(const uint8_t *p, const uint8_t *end)
+    {
+        for (; end - p >= 16; p += 16)
+        {
+            if (vmaxvq_u8(vld1q_u8(p)) >= 0x80)
+            {
+                break;
+            }
+        }
+        return skipASCII(p, end);
+    }
+
+    const char* validateNEON(const char *begin, const char *end)
+    {
+        return validate<skipASCIINEON>(begin, end);
+    }
+
+#endif
+}
+
+void bindUTF8Kernels(SimdKernels &kernels, unsigned features)
+{
+    kernels.validateUTF8 = validateScalar;
+#if SJ_SIMD_SSE2
+    if (features & CPU_SSE2)
+    {
+        kernels.validateUTF8 = validateSSE2;
+    }
+#endif
+#if SJ_SIMD_AVX2
+    if (features & CPU_AVX2)
+    {
+        kernels.validateUTF8 = validateAVX2;
+    }
+#endif
+#if SJ_SIMD_AVX512
+    if (features & CPU_AVX512)
+    {
+        kernels.validateUTF8 = validateAVX512;
+    }
+#endif
+#if SJ_SIMD_NEON
+    if (features & CPU_NEON)
+    {
+        kernels.validateUTF8 = validateNEON;
+    }
+#endif
+}
+
+const char* validateUTF8(const char *begin, const char *end)
+{
+    return getSimdKernels().validateUTF8(begin, end);
+}
+
+NS_SMARTJSON_END
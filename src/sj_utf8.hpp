@@ -0,0 +1,16 @@
+﻿#pragma once
+#include "sj_config.hpp"
+
+#include <cstddef>
+
+NS_SMARTJSON_BEGIN
+
+/**
+ *  检查[begin, end)是否是合法的UTF-8编码(RFC 3629)。
+ *  不允许过长编码、代理区(U+D800~U+DFFF)和超过U+10FFFF的码点。
+ *  使用SIMD指令(AVX-512/AVX2/SSE2/NEON，运行时选择，不支持时每次检查8个字节)跳过ASCII字符，只逐字节检查多字节序列。
+ *  @return 合法时返回nullptr；否则返回第一个非法序列的起始位置。
+ */
+const char* validateUTF8(const char *begin, const char *end);
+
+NS_SMARTJSON_END
@@ -0,0 +1,236 @@
+﻿#pragma once
+#include "sj_config.hpp"
+#include "sj_node.hpp"
+#include "sj_number.hpp"
+
+#include <cstddef>
+#include <limits>
+
+NS_SMARTJSON_BEGIN
+
+/** 解析器内部使用的工具函数 */
+
+inline int toHex(char ch)
+{
+    if (ch >= '0' && ch <= '9')
+    {
+        return ch - '0';
+    }
+    if (ch >= 'a' && ch <= 'f')
+    {
+        return ch - 'a' + 10;
+    }
+    if (ch >= 'A' && ch <= 'F')
+    {
+        return ch - 'A' + 10;
+    }
+    return -1;
+}
+
+inline int toOct(char ch)
+{
+    if (ch >= '0' && ch <= '7')
+    {
+        return ch - '0';
+    }
+    return -1;
+}
+
+/** 数字、true、false、null后面允许出现的字符 */
+inline bool isDelimiter(char ch)
+{
+    switch (ch)
+    {
+    case ' ':
+    case '\t':
+    case '\r':
+    case '\n':
+    case ',':
+    case ':':
+    case ']':
+    case '}':
+    case '[':
+    case '{':
+        return true;
+    default:
+        return false;
+    }
+}
+
+/** 数字的解析结果是否可以存储为Integer */
+inline bool isInteger(const NumberResult &result)
+{
+    return !result.isFloat &&
+        result.integer >= std::numeric_limits<Integer>::min() &&
+        result.integer <= std::numeric_limits<Integer>::max();
+}
+
+/** 将数字的解析结果赋值给node。超出Integer范围的整数，转换为浮点数 */
+inline void setNumber(Node &node, const NumberResult &result)
+{
+    if (isInteger(result))
+    {
+        node = (Integer)result.integer;
+    }
+    else
+    {
+        node = result.isFloat ? result.real : (double)result.integer;
+    }
+}
+
+/** 转换'\\'后面的转义字符 */
+inline char translateChar(char ch)
+{
+    switch (ch)
+    {
+    case 'b': return '\b';
+    case 'f': return '\f';
+    case 'n': return '\n';
+    case 't': return '\t';
+    case 'r': return '\r';
+    case '"': return '"';
+    case '\\': return '\\';
+    case '/': return '/';
+    default:
+        return ch;
+    }
+}
+
+/** 是否是json标准定义的转义字符，不包括'u' */
+inline bool isEscapeChar(char ch)
+{
+    switch (ch)
+    {
+    case 'b': case 'f': case 'n': case 't': case 'r': case '"': case '\\': case '/':
+        return true;
+    default:
+        return false;
+    }
+}
+
+/** 将unicode编码转换为utf8，返回写入的字节数。buffer至少需要4个字节 */
+inline size_t unicodeCharToUTF8(char *buffer, unsigned int cp)
+{
+    // based on description from http://en.wikipedia.org/wiki/UTF-8
+    if (cp <= 0x7f)
+    {
+        buffer[0] = static_cast<char>(cp);
+        return 1;
+    }
+    else if (cp <= 0x7FF)
+    {
+        buffer[0] = static_cast<char>(0xC0 | (0x1f & (cp >> 6)));
+        buffer[1] = static_cast<char>(0x80 | (0x3f & cp));
+        return 2;
+    }
+    else if (cp <= 0xFFFF)
+    {
+        buffer[0] = static_cast<char>(0xE0 | (0xf & (cp >> 12)));
+        buffer[1] = static_cast<char>(0x80 | (0x3f & (cp >> 6)));
+        buffer[2] = static_cast<char>(0x80 | (0x3f & cp));
+        return 3;
+    }
+    else if (cp <= 0x10FFFF)
+    {
+        buffer[0] = static_cast<char>(0xF0 | (0x7 & (cp >> 18)));
+        buffer[1] = static_cast<char>(0x80 | (0x3f & (cp >> 12)));
+        buffer[2] = static_cast<char>(0x80 | (0x3f & (cp >> 6)));
+        buffer[3] = static_cast<char>(0x80 | (0x3f & cp));
+        return 4;
+    }
+    return 0;
+}
+
+/** 解析'\u'后面的4个16进制字符，以及可能的代理对 */
+inline bool parseUnicodeEscape(const char *&p, const char *end, unsigned int &unicode)
+{
+    unsigned int code = 0;
+    for (int k = 0; k < 2; ++k)
+    {
+        if (end - p < 4)
+        {
+            return false;
+        }
+
+        code = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            int v = toHex(*p++);
+            if (v < 0)
+            {
+                return false;
+            }
+            code = (code << 4) | (unsigned int)v;
+        }
+
+        if (k == 0)
+        {
+            unicode = code;
+            if (code < 0xD800 || code > 0xDBFF)
+            {
+                return true;
+            }
+            if (end - p < 2 || p[0] != '\\' || p[1] != 'u')
+            {
+                return false;
+            }
+            p += 2;
+        }
+    }
+
+    unicode = 0x10000 + ((unicode & 0x3FF) << 10) + (code & 0x3FF);
+    return true;
+}
+
+/** 解码[p, end)之间的转义字符，结果写入dest。dest可以和p相同。
+ *  hexEscape为true时，支持'\x'开头的2位16进制字符。
+ *  @return 返回写入的结束位置，如果有错误返回nullptr，errorCode不为空时返回错误码(RC_INVALID_UNICODE或RC_INVALID_CHAR)。
+ */
+inline char* decodeString(const char *p, const char *end, char *dest, bool hexEscape, int *errorCode = nullptr)
+{
+    while (p < end)
+    {
+        char ch = *p++;
+        if (ch != '\\')
+        {
+            *dest++ = ch;
+            continue;
+        }
+
+        ch = *p++;
+        if (ch == 'u')
+        {
+            unsigned int unicode;
+            if (!parseUnicodeEscape(p, end, unicode))
+            {
+                if (errorCode != nullptr)
+                {
+                    *errorCode = RC_INVALID_UNICODE;
+                }
+                return nullptr;
+            }
+            dest += unicodeCharToUTF8(dest, unicode);
+        }
+        else if (ch == 'x' && hexEscape)
+        {
+            int hi, lo;
+            if (end - p < 2 || (hi = toHex(p[0])) < 0 || (lo = toHex(p[1])) < 0)
+            {
+                if (errorCode != nullptr)
+                {
+                    *errorCode = RC_INVALID_CHAR;
+                }
+                return nullptr;
+            }
+            *dest++ = (char)((hi << 4) | lo);
+            p += 2;
+        }
+        else
+        {
+            *dest++ = translateChar(ch);
+        }
+    }
+    return dest;
+}
+
+NS_SMARTJSON_END
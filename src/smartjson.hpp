@@ -4,5 +4,15 @@
 #include "sj_node.hpp"
 #include "sj_parser.hpp"
 #include "sj_binary_parser.hpp"
+#include "sj_source_buffer.hpp"
+#include "sj_fast_parser.hpp"
+#include "sj_reader.hpp"
+#include "sj_incremental_parser.hpp"
+#include "sj_json_lines.hpp"
+#include "sj_parallel_parser.hpp"
+#include "sj_lazy_parser.hpp"
+#include "sj_minify.hpp"
+#include "sj_number_format.hpp"
+#include "sj_binding.hpp"
 
 #endif /* SMART_JSON_HPP */
@@ -0,0 +1,238 @@
+﻿//
+//  benchmark.cpp
+//  smartjson
+//
+//  解析器的吞吐量测试。
+//  usage: sbench input.json [repeat] [simd]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "smartjson.hpp"
+#include "sj_cpu.hpp"
+#include "sj_mapped_file.hpp"
+
+namespace
+{
+    /** 重复运行多次，返回最快一次的耗时(秒) */
+    double measure(int repeat, const std::function<bool()> &func)
+    {
+        double best = 0;
+        for (int i = 0; i < repeat; ++i)
+        {
+            auto start = std::chrono::steady_clock::now();
+            bool ret = func();
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (!ret)
+            {
+                return -1;
+            }
+            if (i == 0 || elapsed < best)
+            {
+                best = elapsed;
+            }
+        }
+        return best;
+    }
+
+    void report(const char *name, size_t size, double seconds)
+    {
+        std::cout.width(20);
+        std::cout << std::left << name;
+        if (seconds < 0)
+        {
+            std::cout << "failed" << std::endl;
+        }
+        else
+        {
+            std::cout << (size / seconds / 1024 / 1024) << " MB/s, " << seconds * 1000 << " ms" << std::endl;
+        }
+    }
+
+    template <typename T>
+    bool parseWith(T &parser, const char *data, size_t size)
+    {
+        return parser.parseFromData(data, size);
+    }
+}
+
+const char *help = R"(parser throughput benchmark.
+usage: sbench input.json [repeat] [simd]
+simd: bit mask of the instruction sets to use, see CpuFeature. 0 forces the scalar kernels.
+)";
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << help << std::endl;
+        return 0;
+    }
+
+    smartjson::MappedFile file;
+    if (!file.open(argv[1]))
+    {
+        std::cout << "Failed open file: " << argv[1] << std::endl;
+        return -1;
+    }
+    const char *data = file.data();
+    size_t size = file.size();
+    int repeat = argc > 2 ? std::max(1, atoi(argv[2])) : 5;
+    if (argc > 3)
+    {
+        smartjson::setSimdFeatures((unsigned)strtoul(argv[3], nullptr, 0));
+    }
+
+    std::cout << "file: " << argv[1] << ", size: " << size << " bytes, repeat: " << repeat
+        << ", simd: 0x" << std::hex << smartjson::getSimdFeatures() << std::dec << std::endl;
+
+    report("Parser", size, measure(repeat, [&]()
+    {
+        smartjson::Parser parser;
+        return parseWith(parser, data, size);
+    }));
+
+    report("Parser(in-situ)", size, measure(repeat, [&]()
+    {
+        smartjson::Parser parser;
+        parser.inSitu_ = true;
+        return parseWith(parser, data, size);
+    }));
+
+    report("Parser(presize)", size, measure(repeat, [&]()
+    {
+        smartjson::Parser parser;
+        parser.presize_ = true;
+        return parseWith(parser, data, size);
+    }));
+
+    report("Parser(utf8)", size, measure(repeat, [&]()
+    {
+        smartjson::Parser parser;
+        parser.validateUTF8_ = true;
+        return parseWith(parser, data, size);
+    }));
+
+    // 反复解析到同一棵树中，复用已有的节点
+    smartjson::Node existing;
+    report("Parser(parseInto)", size, measure(repeat, [&]()
+    {
+        smartjson::Parser parser;
+        return parser.parseInto(existing, data, size);
+    }));
+    existing.setNull();
+
+    report("Parser(SAX)", size, measure(repeat, [&]()
+    {
+        smartjson::IHandler handler;
+        smartjson::Parser parser;
+        parser.setHandler(&handler);
+        return parseWith(parser, data, size);
+    }));
+
+    // 不支持注释等扩展的输入，可以用StrictParser解析
+    report("StrictParser", size, measure(repeat, [&]()
+    {
+        smartjson::StrictParser parser;
+        return parseWith(parser, data, size);
+    }));
+
+    report("Parser(SAX, utf8)", size, measure(repeat, [&]()
+    {
+        smartjson::IHandler handler;
+        smartjson::Parser parser;
+        parser.setHandler(&handler);
+        parser.validateUTF8_ = true;
+        return parseWith(parser, data, size);
+    }));
+
+    report("StrictParser(SAX)", size, measure(repeat, [&]()
+    {
+        smartjson::IHandler handler;
+        smartjson::StrictParser parser;
+        parser.setHandler(&handler);
+        return parseWith(parser, data, size);
+    }));
+
+    report("FastParser", size, measure(repeat, [&]()
+    {
+        smartjson::FastParser parser;
+        return parseWith(parser, data, size);
+    }));
+
+    report("FastParser(presize)", size, measure(repeat, [&]()
+    {
+        smartjson::FastParser parser;
+        parser.presize_ = true;
+        return parseWith(parser, data, size);
+    }));
+
+    report("LazyParser", size, measure(repeat, [&]()
+    {
+        smartjson::LazyParser parser;
+        return parseWith(parser, data, size);
+    }));
+
+    report("IncrementalParser", size, measure(repeat, [&]()
+    {
+        smartjson::IncrementalParser parser;
+        return parseWith(parser, data, size);
+    }));
+
+    report("ParallelParser", size, measure(repeat, [&]()
+    {
+        smartjson::ParallelParser parser;
+        return parseWith(parser, data, size);
+    }));
+
+    report("JsonReader", size, measure(repeat, [&]()
+    {
+        smartjson::JsonReader reader;
+        reader.open(data, size);
+        while (reader.next() != smartjson::JsonReader::TK_END)
+        {
+        }
+        return reader.getErrorCode() == smartjson::RC_OK;
+    }));
+
+    std::string minified;
+    report("minify", size, measure(repeat, [&]()
+    {
+        return smartjson::minify(data, size, minified);
+    }));
+
+    // 二进制格式使用Parser的结果生成
+    smartjson::Parser parser;
+    if (parser.parseFromData(data, size))
+    {
+        smartjson::BinaryWriter writer;
+        std::string binary = writer.toString(parser.getRoot());
+        report("BinaryParser", binary.size(), measure(repeat, [&]()
+        {
+            smartjson::BinaryParser binaryParser;
+            return binaryParser.parseFromString(binary);
+        }));
+
+        // 写入器的吞吐量按输出的大小计算
+        smartjson::MemorySink sink;
+        smartjson::Writer jsonWriter;
+        jsonWriter.write(parser.getRoot(), sink);
+        report("Writer", sink.size(), measure(repeat, [&]()
+        {
+            sink.clear();
+            return jsonWriter.write(parser.getRoot(), sink);
+        }));
+
+        report("BinaryWriter", binary.size(), measure(repeat, [&]()
+        {
+            sink.clear();
+            return writer.write(parser.getRoot(), sink);
+        }));
+    }
+    return 0;
+}
@@ -2,12 +2,24 @@
 
 #include "smartjson.hpp"
 #include "sj_binary_parser.hpp"
+#include "sj_cpu.hpp"
 #include "sj_allocator_imp.hpp"
+#include "sj_source_buffer.hpp"
+#include "sj_string_scan.hpp"
+#include "sj_utf8.hpp"
 
+#include <sstream>
 #include <string>
 #include <cassert>
 #include <cmath>
+#include <cstdio>
 #include <fstream>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <vector>
 
 #define TEST_EQUAL(EXP) testEqual(EXP, #EXP, __LINE__)
 void testEqual(bool ret, const char *exp, int line)
@@ -256,12 +268,1551 @@ void testParser()
     TEST_EQUAL(almoseEqual(v2x.x, 100.55));
     TEST_EQUAL(almoseEqual(v2x.y, 200.22));
     
+    // the input buffer doesn't need to be terminated by '\0'.
+    std::string text = "[1, 2, 3]]]]";
+    TEST_EQUAL(parser.parseFromData(text.data(), 9));
+    TEST_EQUAL(parser.getRoot().size() == 3);
+    TEST_EQUAL(!parser.parseFromData(text.data(), 8));
+
+    // load from file by memory mapping.
+    const char *fileName = "test_parser.json";
+    {
+        std::ofstream output(fileName);
+        output << json;
+    }
+    TEST_EQUAL(parser.parseFromFile(fileName));
+    TEST_EQUAL(parser.getRoot() == root);
+    std::remove(fileName);
+    TEST_EQUAL(!parser.parseFromFile(fileName));
+    TEST_EQUAL(parser.getErrorCode() == smartjson::RC_OPEN_FILE_ERROR);
+
+    // the error position is computed from the input after the failure.
+    const char *invalid = "{\"a\" : [1, 2],\n\t\"b\" : \"x\",\n  \"c\" : tru}";
+    TEST_EQUAL(!parser.parseFromString(invalid));
+    TEST_EQUAL(parser.getErrorCode() == smartjson::RC_INVALID_TRUE);
+    TEST_EQUAL(parser.getErrorOffset() == (size_t)(strstr(invalid, "tru}") - invalid) + 4);
+    TEST_EQUAL(parser.getLine() == 3 && parser.getColumn() == 13);
+    TEST_EQUAL(!parser.parseFromString("[1,\n\"abc\n\"]"));
+    TEST_EQUAL(parser.getErrorCode() == smartjson::RC_INVALID_STRING);
+    TEST_EQUAL(parser.getErrorOffset() == 9 && parser.getLine() == 3 && parser.getColumn() == 1);
+
+    // keys are inserted as they are, '/' is not treated as a path separator.
+    TEST_EQUAL(parser.parseFromString("{\"a/b\" : 1, \"c\" : 2, \"c\" : 3}"));
+    TEST_EQUAL(parser.getRoot().size() == 2 && !parser.getRoot().hasMember("a"));
+    TEST_EQUAL(parser.getRoot().findMember(smartjson::Node("a/b"))->second == 1);
+    TEST_EQUAL(parser.getRoot()["c"] == 3);
+
     std::cout << "print json:" << std::endl;
     smartjson::Writer writer;
     writer.sortKey_ = true;
     writer.write(root, std::cout);
 }
 
+void testParseInto()
+{
+    std::cout << "test parse into..." << std::endl;
+
+    const char *oldText = R"({"name" : "cfg", "list" : [1, "a", [2, 3], {"x" : 1}], "pos" : {"x" : 1, "y" : 2},
+        "gone" : [1], "grow" : [1], "kind" : {"a" : 1}, 10 : "ten"})";
+    const char *newText = R"({"name" : "cfg", "list" : [1, "b", [4], {"x" : 2, "z" : 3}], "pos" : {"x" : 5, "y" : 6},
+        "grow" : [1, 2, 3], /* dict becomes array */ "kind" : ["a"], 10 : "ten", "new" : {"k" : "v"}})";
+
+    smartjson::Parser parser;
+    smartjson::Node config;
+    TEST_EQUAL(parser.parseInto(config, oldText));
+    TEST_EQUAL(parser.parseFromString(oldText) && config == parser.getRoot());
+
+    const smartjson::Dict *root = config.rawDict();
+    const smartjson::Array *list = config["list"].rawArray();
+    const smartjson::Array *inner = config["list"][2].rawArray();
+    const smartjson::Dict *member = config["list"][3].rawDict();
+    const smartjson::StringValue *name = config["name"].rawString();
+    const smartjson::StringValue *ten = config[10].rawString();
+    const smartjson::Array *grow = config["grow"].rawArray();
+    smartjson::Node shared = config["pos"];
+
+    TEST_EQUAL(parser.parseInto(config, newText));
+    TEST_EQUAL(parser.parseFromString(newText) && config == parser.getRoot());
+
+    // unique containers and unchanged strings are reused.
+    TEST_EQUAL(config.rawDict() == root && config["list"].rawArray() == list);
+    TEST_EQUAL(config["list"][2].rawArray() == inner && config["list"][3].rawDict() == member);
+    TEST_EQUAL(config["name"].rawString() == name && config[10].rawString() == ten);
+    TEST_EQUAL(config["grow"].rawArray() == grow);
+    TEST_EQUAL(!config.hasMember("gone") && config["kind"].isArray());
+
+    // shared containers are never modified.
+    TEST_EQUAL(config["pos"].rawDict() != shared.rawDict());
+    TEST_EQUAL(shared["x"] == 1 && shared["y"] == 2);
+
+    // the existing tree is untouched on failure.
+    smartjson::Node snapshot = config.deepClone();
+    TEST_EQUAL(!parser.parseInto(config, R"({"name" : "x", "list" : [1, 2,]})"));
+    TEST_EQUAL(parser.getErrorCode() == smartjson::RC_INVALID_NUMBER);
+    TEST_EQUAL(config == snapshot && config.rawDict() == root);
+
+    // duplicated keys, empty containers and a different root type.
+    TEST_EQUAL(parser.parseInto(config, R"({"list" : [], "list" : {}, "name" : "cfg"})"));
+    TEST_EQUAL(config.rawDict() == root && config.size() == 2 && config["list"].isDict() && config["list"].size() == 0);
+    TEST_EQUAL(config["name"].rawString() == name);
+    TEST_EQUAL(parser.parseInto(config, "[1, 2]"));
+    TEST_EQUAL(config.isArray() && config.size() == 2);
+}
+
+/** record the events as a compact text. */
+class RecordHandler : public smartjson::IHandler
+{
+public:
+    std::string text_;
+    int stopAtKey_ = -1;
+
+    bool onNull() override { text_ += "null,"; return true; }
+    bool onBool(bool value) override { text_ += value ? "true," : "false,"; return true; }
+    bool onInt(smartjson::Integer value) override { text_ += std::to_string(value) + ","; return true; }
+    bool onFloat(double value) override { text_ += std::to_string(value) + ","; return true; }
+    bool onString(const char *str, size_t length) override
+    {
+        text_ += "\"" + std::string(str, length) + "\",";
+        return true;
+    }
+    bool onStartDict() override { text_ += "{"; return true; }
+    bool onKey(const char *str, size_t length) override
+    {
+        text_ += std::string(str, length) + ":";
+        return stopAtKey_-- != 0;
+    }
+    bool onEndDict(size_t memberCount) override { text_ += "}" + std::to_string(memberCount) + ","; return true; }
+    bool onStartArray() override { text_ += "["; return true; }
+    bool onEndArray(size_t elementCount) override { text_ += "]" + std::to_string(elementCount) + ","; return true; }
+};
+
+void testSaxHandler()
+{
+    std::cout << "test sax handler..." << std::endl;
+
+    const char *text = "{\"a\" : [1, -2.5, \"s\\n\", true, false, null], // comment\n"
+        "\"b\" : {}, 3 : [], \"c\" : {\"d\" : 0x10}}";
+
+    RecordHandler handler;
+    smartjson::Parser parser;
+    parser.setHandler(&handler);
+    TEST_EQUAL(parser.parseFromString(text));
+    TEST_EQUAL(parser.getRoot().isNull());
+    TEST_EQUAL(handler.text_ == "{a:[1,-2.500000,\"s\n\",true,false,null,]6,b:{}0,3,[]0,c:{d:16,}1,}4,");
+
+    // the handler can stop parsing at any time.
+    handler.text_.clear();
+    handler.stopAtKey_ = 1;
+    TEST_EQUAL(!parser.parseFromString(text));
+    TEST_EQUAL(parser.getErrorCode() == smartjson::RC_HANDLER_ABORTED);
+    TEST_EQUAL(handler.text_ == "{a:[1,-2.500000,\"s\n\",true,false,null,]6,b:");
+
+    // the in-situ mode passes strings which reference the input buffer.
+    handler.text_.clear();
+    handler.stopAtKey_ = -1;
+    parser.inSitu_ = true;
+    TEST_EQUAL(parser.parseFromString(text));
+    TEST_EQUAL(handler.text_ == "{a:[1,-2.500000,\"s\n\",true,false,null,]6,b:{}0,3,[]0,c:{d:16,}1,}4,");
+    parser.inSitu_ = false;
+
+    const char *invalidCases[] = { "[1,", "{\"a\" 1}", "{true : 1}", "{1.5 : 1}", "[nul]", "[\"a]" };
+    for (const char *invalid : invalidCases)
+    {
+        TEST_EQUAL(!parser.parseFromString(invalid));
+        TEST_EQUAL(parser.getErrorCode() != smartjson::RC_OK);
+    }
+
+    parser.setHandler(nullptr);
+    TEST_EQUAL(parser.parseFromString(text));
+    TEST_EQUAL(parser.getRoot()["c"]["d"] == 16);
+}
+
+/** rebuild the document from the tokens of JsonReader. */
+bool readNode(smartjson::JsonReader &reader, smartjson::JsonReader::Token token, smartjson::Node &node)
+{
+    typedef smartjson::JsonReader R;
+    switch (token)
+    {
+    case R::TK_NULL: node.setNull(); return true;
+    case R::TK_BOOL: node = reader.getBool(); return true;
+    case R::TK_INT: node = reader.getInt(); return true;
+    case R::TK_FLOAT: node = reader.getFloat(); return true;
+    case R::TK_STRING: node = std::string(reader.getString(), reader.getLength()); return true;
+    case R::TK_START_ARRAY:
+        node.setArray();
+        for (token = reader.next(); token != R::TK_END_ARRAY; token = reader.next())
+        {
+            smartjson::Node child;
+            if (!readNode(reader, token, child)) return false;
+            node.pushBack(child);
+        }
+        return true;
+    case R::TK_START_DICT:
+        node.setDict();
+        for (token = reader.next(); token != R::TK_END_DICT; token = reader.next())
+        {
+            if (token != R::TK_KEY) return false;
+            smartjson::Node key = std::string(reader.getString(), reader.getLength());
+            smartjson::Node value;
+            if (!readNode(reader, reader.next(), value)) return false;
+            node.setMember(key, value);
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+void testJsonReader()
+{
+    std::cout << "test json reader..." << std::endl;
+
+    typedef smartjson::JsonReader R;
+    smartjson::Parser parser;
+    TEST_EQUAL(parser.parseFromData(json, strlen(json)));
+
+    smartjson::JsonReader reader;
+    smartjson::Node root;
+    TEST_EQUAL(reader.open(json, strlen(json)));
+    TEST_EQUAL(readNode(reader, reader.next(), root));
+    TEST_EQUAL(reader.next() == R::TK_END);
+    TEST_EQUAL(reader.getErrorCode() == smartjson::RC_OK);
+    TEST_EQUAL(root == parser.getRoot());
+
+    // skip the uninteresting values, and find "pos.y".
+    const char *text = "{\"a\" : [1, [2, \"]\"], {\"b\" : /* } */ 3}], \"s\" : \"x\", \"pos\" : {\"x\" : 1, \"y\" : 2.5}}";
+    reader.open(text, strlen(text));
+    TEST_EQUAL(reader.next() == R::TK_START_DICT);
+    TEST_EQUAL(reader.depth() == 1);
+    TEST_EQUAL(reader.skipValue());
+    TEST_EQUAL(reader.skipValue());
+    TEST_EQUAL(reader.next() == R::TK_KEY);
+    TEST_EQUAL(std::string(reader.getString(), reader.getLength()) == "pos");
+    TEST_EQUAL(reader.next() == R::TK_START_DICT);
+    TEST_EQUAL(reader.depth() == 2);
+    TEST_EQUAL(reader.skipValue());
+    TEST_EQUAL(reader.next() == R::TK_KEY);
+    TEST_EQUAL(reader.next() == R::TK_FLOAT);
+    TEST_EQUAL(reader.getFloat() == 2.5);
+    TEST_EQUAL(!reader.skipValue());
+    TEST_EQUAL(reader.next() == R::TK_END_DICT);
+    TEST_EQUAL(reader.next() == R::TK_END_DICT);
+    TEST_EQUAL(reader.depth() == 0);
+    TEST_EQUAL(reader.next() == R::TK_END);
+    TEST_EQUAL(reader.getErrorCode() == smartjson::RC_OK);
+
+    const char *invalidCases[] = { "[1,", "{\"a\" 1}", "[1 2]", "{\"a\" : [1}}", "[nul]", "[1] 2", "[\"a]" };
+    for (const char *invalid : invalidCases)
+    {
+        reader.open(invalid, strlen(invalid));
+        while (reader.next() != R::TK_END) {}
+        TEST_EQUAL(reader.getErrorCode() != smartjson::RC_OK);
+    }
+
+    // skipping an unclosed container must fail.
+    reader.open("[[1, [2]", 8);
+    TEST_EQUAL(reader.next() == R::TK_START_ARRAY);
+    TEST_EQUAL(!reader.skipValue());
+    TEST_EQUAL(reader.getErrorCode() == smartjson::RC_END_OF_FILE);
+    TEST_EQUAL(reader.getErrorOffset() == 8 && reader.getLine() == 1 && reader.getColumn() == 9);
+
+    // the current position is available while reading.
+    reader.open("[1,\n  2]", 8);
+    TEST_EQUAL(reader.next() == R::TK_START_ARRAY && reader.next() == R::TK_INT && reader.next() == R::TK_INT);
+    TEST_EQUAL(reader.getLine() == 2 && reader.getColumn() == 4);
+}
+
+void describe(smartjson::Schema<Vector2> &schema)
+{
+    schema.field("x", &Vector2::x);
+    schema.field("y", &Vector2::y);
+}
+
+struct Monster
+{
+    int64_t id = 0;
+    std::string name;
+    bool boss = false;
+    double speed = 1.0;
+    uint8_t level = 1;
+    Vector2 pos = { 0, 0 };
+    std::vector<std::string> tags;
+    std::vector<bool> flags;
+    std::unordered_map<std::string, int> drops;
+    std::map<std::string, std::vector<Vector2>> paths;
+};
+
+void describe(smartjson::Schema<Monster> &schema)
+{
+    schema.field("id", &Monster::id);
+    schema.field("name", &Monster::name);
+    schema.field("boss", &Monster::boss);
+    schema.field("speed", &Monster::speed);
+    schema.field("level", &Monster::level);
+    schema.field("pos", &Monster::pos);
+    schema.field("tags", &Monster::tags);
+    schema.field("flags", &Monster::flags);
+    schema.field("drops", &Monster::drops);
+    schema.field("paths", &Monster::paths);
+}
+
+void testBinding()
+{
+    std::cout << "test binding..." << std::endl;
+
+    const char *text = R"([
+        {"id" : 1, "name" : "slime", "speed" : 2, "pos" : {"x" : 1.5, "y" : -2},
+         "tags" : ["a", "b\n"], "flags" : [true, false, true], "drops" : {"gold" : 10, "1" : 2, 3 : 4},
+         "paths" : {"p1" : [{"x" : 1, "y" : 2}, {"y" : 3}]}},
+        // fields in any order, unknown fields and null values
+        {"boss" : true, "unknown" : {"a" : [1, {"b" : 2}]}, "id" : 0x10, "name" : null,
+         "level" : 200, "tags" : [], "extra" : "x", "speed" : 3.5e1}
+    ])";
+
+    std::vector<Monster> monsters;
+    smartjson::JsonReader reader;
+    reader.open(text, strlen(text));
+    TEST_EQUAL(smartjson::readJson(monsters, reader));
+    TEST_EQUAL(monsters.size() == 2);
+
+    const Monster &a = monsters[0];
+    TEST_EQUAL(a.id == 1 && a.name == "slime" && !a.boss && a.speed == 2.0 && a.level == 1);
+    TEST_EQUAL(a.pos.x == 1.5f && a.pos.y == -2.0f);
+    TEST_EQUAL(a.tags.size() == 2 && a.tags[1] == "b\n");
+    TEST_EQUAL(a.flags.size() == 3 && a.flags[0] && !a.flags[1] && a.flags[2]);
+    TEST_EQUAL(a.drops.size() == 3 && a.drops.at("gold") == 10 && a.drops.at("3") == 4);
+    TEST_EQUAL(a.paths.at("p1").size() == 2 && a.paths.at("p1")[1].y == 3.0f && a.paths.at("p1")[1].x == 0.0f);
+
+    const Monster &b = monsters[1];
+    TEST_EQUAL(b.id == 16 && b.name.empty() && b.boss && b.speed == 35.0 && b.level == 200);
+    TEST_EQUAL(b.tags.empty() && b.drops.empty() && b.pos.x == 0.0f);
+
+    // type mismatch
+    std::unordered_map<std::string, Monster> table;
+    const char *invalid = "{\"m1\" : {\"id\" : 1},\n \"m2\" : {\"name\" : [1]}}";
+    reader.open(invalid, strlen(invalid));
+    TEST_EQUAL(!smartjson::readJson(table, reader));
+    TEST_EQUAL(reader.getErrorCode() == smartjson::RC_INVALID_TYPE);
+    TEST_EQUAL(reader.getLine() == 2);
+
+    // syntax errors are reported by the reader.
+    const char *broken = "[{\"id\" : 1,}]";
+    reader.open(broken, strlen(broken));
+    TEST_EQUAL(!smartjson::readJson(monsters, reader));
+    TEST_EQUAL(reader.getErrorCode() == smartjson::RC_INVALID_KEY);
+
+    std::vector<int> numbers;
+    reader.open("[1, 2] 3", 8);
+    TEST_EQUAL(!smartjson::readJson(numbers, reader));
+
+    // integers only accept integral values inside the range of the target type.
+    std::vector<uint8_t> bytes;
+    for (const char *value : { "[1e30]", "[-1e30]", "[1.5]", "[2147483648]", "[-2147483649]" })
+    {
+        reader.open(value, strlen(value));
+        TEST_EQUAL(!smartjson::readJson(numbers, reader));
+        TEST_EQUAL(reader.getErrorCode() == smartjson::RC_INVALID_TYPE);
+    }
+    for (const char *value : { "[300]", "[-1]", "[256.0]" })
+    {
+        reader.open(value, strlen(value));
+        TEST_EQUAL(!smartjson::readJson(bytes, reader));
+        TEST_EQUAL(reader.getErrorCode() == smartjson::RC_INVALID_TYPE);
+    }
+
+    reader.open("[-2147483648, 2.0]", 18);
+    TEST_EQUAL(smartjson::readJson(numbers, reader));
+    TEST_EQUAL(numbers.size() == 2 && numbers[0] == std::numeric_limits<int>::min() && numbers[1] == 2);
+    reader.open("[255, 2.54e2]", 13);
+    TEST_EQUAL(smartjson::readJson(bytes, reader));
+    TEST_EQUAL(bytes.size() == 2 && bytes[0] == 255 && bytes[1] == 254);
+}
+
+void testIncrementalParser()
+{
+    std::cout << "test incremental parser..." << std::endl;
+
+    smartjson::Parser parser;
+    TEST_EQUAL(parser.parseFromData(json, strlen(json)));
+    smartjson::Node expected = parser.getRoot();
+
+    // split the input at every position, which cuts strings, numbers, escapes and comments.
+    smartjson::IncrementalParser incParser;
+    size_t length = strlen(json);
+    for (size_t i = 0; i <= length; ++i)
+    {
+        incParser.reset();
+        TEST_EQUAL(incParser.feed(json, i));
+        TEST_EQUAL(incParser.feed(json + i, length - i));
+        TEST_EQUAL(incParser.finish());
+        TEST_EQUAL(incParser.getRoot() == expected);
+    }
+
+    // one byte per chunk.
+    incParser.reset();
+    for (size_t i = 0; i < length; ++i)
+    {
+        TEST_EQUAL(incParser.feed(json + i, 1));
+    }
+    TEST_EQUAL(incParser.finish());
+    TEST_EQUAL(incParser.getRoot() == expected);
+    TEST_EQUAL(incParser.getOffset() == length);
+
+    // the IParser interface parses the whole data at once.
+    TEST_EQUAL(incParser.parseFromString("[\"\\x41\\u4f60\", 1.5e3, {\"k\" : [true, null]}]"));
+    TEST_EQUAL(incParser.getRoot()[(size_t)0] == "A\xe4\xbd\xa0");
+    TEST_EQUAL(incParser.getRoot()[(size_t)1] == 1500.0);
+    TEST_EQUAL(incParser.getRoot()[(size_t)2]["k"][(size_t)0] == true);
+
+    const char *invalidCases[] = { "", "[1,", "{\"a\" 1}", "[1 2]", "{\"a\" : [1}}", "[nul]",
+        "[1] 2", "[\"a]", "[1,]", "{[] : 1}", "[01]", "[/ 1]", "[1 /* ]", "[\"a\n\"]", "1" };
+    for (const char *invalid : invalidCases)
+    {
+        incParser.reset();
+        incParser.feed(invalid, strlen(invalid));
+        TEST_EQUAL(!incParser.finish());
+        TEST_EQUAL(incParser.getErrorCode() != smartjson::RC_OK);
+    }
+
+    // the grammar and the error codes match Parser, whether the data is fed at once or byte by byte.
+    const char *parserCases[] = { "[1/*c*/]", "[1 /*c*/]", "{\"a\" /*c*/ : 1}", "[1, /*c*/ 2]", "[/*c*/]",
+        "{\"a\" : 1}//x", "/*x*/{}", "[truex]", "[true/*c*/]", "[1]]", "[.5]", "[x]", "{\"a\" x}",
+        "[1,]", "[1}", "[\"\\u12\"]", "[\"\\ud800\"]", "[\"\\x4\"]", "[+1, 0x1F, \"\\q\"]" };
+    for (const char *text : parserCases)
+    {
+        bool ok = parser.parseFromString(text);
+        TEST_EQUAL(incParser.parseFromString(text) == ok);
+        TEST_EQUAL(incParser.getErrorCode() == parser.getErrorCode());
+
+        incParser.reset();
+        for (const char *p = text; *p != 0 && incParser.feed(p, 1); ++p)
+        {
+        }
+        TEST_EQUAL(incParser.finish() == ok);
+        TEST_EQUAL(incParser.getErrorCode() == parser.getErrorCode());
+    }
+
+    // errors are reported as soon as possible, and the following data is ignored.
+    incParser.reset();
+    TEST_EQUAL(incParser.feed("[1, 2", 5));
+    TEST_EQUAL(!incParser.feed("]]", 2));
+    TEST_EQUAL(incParser.getOffset() == 6);
+    TEST_EQUAL(!incParser.feed("[]", 2));
+}
+
+void testPathFilter()
+{
+    std::cout << "test path filter..." << std::endl;
+
+    smartjson::Parser parser;
+    TEST_EQUAL(parser.parseFromData(json, strlen(json)));
+    smartjson::Node expected = parser.getRoot();
+
+    std::vector<std::string> paths = { "name", "pos/x", "array", "s3", "i4/x", "missing/a" };
+    parser.setPathFilter(paths);
+    TEST_EQUAL(parser.parseFromData(json, strlen(json)));
+    smartjson::Node root = parser.getRoot();
+    TEST_EQUAL(root.size() == 4);
+    TEST_EQUAL(root["name"] == expected["name"]);
+    TEST_EQUAL(root["s3"] == expected["s3"]);
+    TEST_EQUAL(root["array"] == expected["array"]);
+    TEST_EQUAL(root["pos"].size() == 1);
+    TEST_EQUAL(root.findMemberByPath("pos/x", 5) == 100.55);
+    TEST_EQUAL(!root.hasMember("age") && !root.hasMember("i4"));
+
+    // keys containing '/', duplicate keys, int keys and null values.
+    const char *text = R"({"a/b" : {"c" : 1, "d" : [2]}, 3 : {"c" : 4}, "a" : {"b" : {"c" : 5}},
+        "x" : null, "y" : "\u4f60\"", "z" : {"c" : 6}})";
+    parser.setPathFilter({ "a/b/c" });
+    TEST_EQUAL(parser.parseFromString(text));
+    root = parser.getRoot();
+    TEST_EQUAL(root.findMemberByPath("a/b/c", 5) == 5);
+    TEST_EQUAL(!root.hasMemberByPath("a/b/d", 5));
+    TEST_EQUAL(!root.hasMember("x") && root.size() == 1);
+
+    paths = { "x", "y", "z/c" };
+    parser.setPathFilter(paths);
+    TEST_EQUAL(parser.parseFromString(text));
+    root = parser.getRoot();
+    TEST_EQUAL(root.size() == 3 && root.hasMember("x") && root["x"].isNull());
+    TEST_EQUAL(root["y"] == "\xe4\xbd\xa0\"");
+    TEST_EQUAL(root["z"]["c"] == 6);
+
+    // skipped values are still validated.
+    smartjson::Parser strictParser;
+    const char *invalid = "{\"a\" : 1, \"b\" : [1, tru],\n \"x\" : 2}";
+    TEST_EQUAL(!strictParser.parseFromString(invalid));
+    TEST_EQUAL(!parser.parseFromString(invalid));
+    TEST_EQUAL(parser.getErrorCode() == strictParser.getErrorCode());
+    TEST_EQUAL(parser.getLine() == strictParser.getLine() && parser.getColumn() == strictParser.getColumn());
+    TEST_EQUAL(!parser.parseFromString("{1.5 : 2}"));
+    TEST_EQUAL(parser.getErrorCode() == smartjson::RC_INVALID_KEY);
+
+    TEST_EQUAL(parser.parseFromString("[1, {\"x\" : 2}]"));
+    TEST_EQUAL(parser.getRoot().isArray() && parser.getRoot().size() == 0);
+
+    parser.setPathFilter(std::vector<std::string>());
+    TEST_EQUAL(parser.parseFromData(json, strlen(json)));
+    TEST_EQUAL(parser.getRoot() == expected);
+}
+
+void testInSituParser()
+{
+    std::cout << "test in-situ parser..." << std::endl;
+
+    smartjson::Parser parser;
+    TEST_EQUAL(parser.parseFromData(json, strlen(json)));
+    smartjson::Node expected = parser.getRoot();
+
+    smartjson::SourceBuffer *buffer = smartjson::SourceBuffer::createFromData(json, strlen(json));
+    buffer->retain();
+    TEST_EQUAL(parser.parse(buffer));
+    {
+        smartjson::Node root = parser.getRoot();
+        TEST_EQUAL(root == expected);
+        TEST_EQUAL(buffer->getRefCount() > 1);
+
+        // strings without escape characters reference the buffer directly.
+        const char *name = root["name"].asCString();
+        TEST_EQUAL(name >= buffer->data() && name < buffer->data() + buffer->size());
+        TEST_EQUAL(strcmp(name, "json") == 0);
+
+        // escaped strings are decoded in place.
+        const char *s3 = root["s3"].asCString();
+        TEST_EQUAL(s3 >= buffer->data() && s3 < buffer->data() + buffer->size());
+        TEST_EQUAL(root["s3"] == "ab\t\r\n\"\\cd");
+        TEST_EQUAL(root["s2"] == "\xe4\xbd\xa0\xe5\xa5\xbd");
+    }
+    TEST_EQUAL(parser.parseFromString("[]"));
+    TEST_EQUAL(buffer->getRefCount() == 1);
+    buffer->release();
+
+    smartjson::Parser parser2(new smartjson::MemoryPoolAllocator());
+    parser2.inSitu_ = true;
+    TEST_EQUAL(parser2.parseFromData(json, strlen(json)));
+    TEST_EQUAL(parser2.getRoot() == expected);
+
+    const char *fileName = "test_insitu.json";
+    {
+        std::ofstream output(fileName);
+        output << json;
+    }
+    TEST_EQUAL(parser2.parseFromFile(fileName));
+    TEST_EQUAL(parser2.getRoot() == expected);
+    std::remove(fileName);
+}
+
+const char *strictJson = R"(
+{
+    "name"   : "json",
+    "age"    : 20,
+    "weight" : 60.5,
+    "i1"     : 1234567890,
+    "i2"     : -123456789,
+    "i3"     : 0,
+    "f1"     : 3.14e2,
+    "f2"     : 3.14E-2,
+    "f3"     : -0.3140e10,
+    "s1"     : "",
+    "s2"     : "\u4f60\u597d\ud83d\ude00",
+    "s3"     : "ab\t\r\n\"\\cd\/",
+    "s4"     : "\\\\\"\\",
+    "array"  : [0, true, false, null, 123, -456, 3.14, "hello\n world!", [], {}],
+    "pos"    : {"x" : 100.55, "y" : 200.22}
+}
+)";
+
+void testUTF8()
+{
+    std::cout << "test utf8..." << std::endl;
+
+    auto check = [](const std::string &text) -> long
+    {
+        const char *error = smartjson::validateUTF8(text.data(), text.data() + text.size());
+        return error == nullptr ? -1 : (long)(error - text.data());
+    };
+
+    std::string ascii(100, 'a');
+    TEST_EQUAL(check("") == -1 && check(ascii) == -1);
+    TEST_EQUAL(check("a\xc2\x80\xdf\xbf\xe0\xa0\x80\xe4\xbd\xa0\xed\x9f\xbf\xef\xbf\xbf") == -1);
+    TEST_EQUAL(check("\xf0\x90\x80\x80\xf0\x9f\x98\x80\xf4\x8f\xbf\xbf") == -1);
+
+    const char *invalidCases[] = {
+        "\x80", "\xc0\x80", "\xc1\xbf", "\xc2", "\xc2\x41", "\xe0\x9f\xbf", "\xe4\xbd", "\xed\xa0\x80",
+        "\xf0\x8f\xbf\xbf", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80", "\xff", "\xe4\xbd\xa0\xa0",
+    };
+    for (const char *invalid : invalidCases)
+    {
+        // the error is found after any number of ascii and multibyte characters.
+        for (size_t n : { 0, 7, 15, 16, 31, 32, 63, 100 })
+        {
+            std::string prefix(n, 'a');
+            TEST_EQUAL(check(prefix + invalid + "abc") == (long)n || check(prefix + invalid + "abc") == (long)n + 3);
+            TEST_EQUAL(check("\xe4\xbd\xa0" + prefix + invalid) >= (long)n + 3);
+        }
+    }
+
+    // the parser validates strings and keys while scanning them.
+    smartjson::Parser parser;
+    std::string text = "{\"k\xe4\xbd\xa0\" : [\"" + ascii + "\xf0\x9f\x98\x80\", \"\\u4f60\\n\"]}";
+    parser.validateUTF8_ = true;
+    TEST_EQUAL(parser.parseFromString(text));
+    TEST_EQUAL(parser.getRoot()["k\xe4\xbd\xa0"][(size_t)0].size() == 104);
+
+    std::string invalid = "[\"abc\", \"" + ascii + "\xe4\xbd\"]";
+    TEST_EQUAL(!parser.parseFromString(invalid));
+    TEST_EQUAL(parser.getErrorCode() == smartjson::RC_INVALID_UTF8);
+    TEST_EQUAL(parser.getErrorOffset() == invalid.find('\xe4'));
+    parser.inSitu_ = true;
+    TEST_EQUAL(!parser.parseFromString(invalid));
+    TEST_EQUAL(parser.getErrorOffset() == invalid.find('\xe4'));
+    parser.inSitu_ = false;
+
+    TEST_EQUAL(!parser.parseFromString("{\"a\xff\" : 1}"));
+    TEST_EQUAL(parser.getErrorCode() == smartjson::RC_INVALID_UTF8 && parser.getErrorOffset() == 3);
+
+    // strings with escapes are reported at the beginning of the string.
+    TEST_EQUAL(!parser.parseFromString("[1, \"\\n\xc0\xaf\"]"));
+    TEST_EQUAL(parser.getErrorCode() == smartjson::RC_INVALID_UTF8 && parser.getErrorOffset() == 5);
+    TEST_EQUAL(!parser.parseFromString("[\"\\xff\"]"));
+    TEST_EQUAL(parser.getErrorCode() == smartjson::RC_INVALID_UTF8);
+
+    parser.validateUTF8_ = false;
+    TEST_EQUAL(parser.parseFromString(invalid));
+}
+
+void testStringScan()
+{
+    std::cout << "test string scan..." << std::endl;
+
+    auto find = [](const std::string &text) -> size_t
+    {
+        return smartjson::findStringSpecial(text.data(), text.data() + text.size()) - text.data();
+    };
+
+    std::string ascii(100, 'a');
+    TEST_EQUAL(find("") == 0 && find(ascii) == 100);
+    for (char special : { '"', '\\', '\n', '\0' })
+    {
+        // the special character is found at any offset of the simd and swar blocks.
+        for (size_t n : { 0, 1, 7, 8, 15, 16, 17, 31, 32, 33, 63, 99 })
+        {
+            std::string text = ascii;
+            text[n] = special;
+            TEST_EQUAL(find(text) == n);
+        }
+    }
+    TEST_EQUAL(find("\t\r\x7f\xe4\xbd\xa0") == 6);
+
+    auto findEscape = [](const std::string &text) -> size_t
+    {
+        return smartjson::findEscapeChar(text.data(), text.data() + text.size()) - text.data();
+    };
+    TEST_EQUAL(findEscape("") == 0 && findEscape(ascii) == 100);
+    for (char special : { '"', '\\', '\n', '\0', '\t', '\x01', '\x1f' })
+    {
+        for (size_t n : { 0, 7, 8, 15, 16, 31, 32, 63, 64, 99 })
+        {
+            std::string text = ascii;
+            text[n] = special;
+            TEST_EQUAL(findEscape(text) == n);
+        }
+    }
+    TEST_EQUAL(findEscape(" \x7f\x80\xe4\xbd\xa0\xff/") == 8);
+
+    // the writer escapes the characters found by the kernel and copies the rest.
+    smartjson::Writer writer;
+    std::string raw = ascii + "\"\\\n\t\r\b\f\xe4\xbd\xa0" + ascii;
+    TEST_EQUAL(writer.toString(smartjson::Node(raw)) == "\"" + ascii + "\\\"\\\\\\n\\t\\r\\b\\f\xe4\xbd\xa0" + ascii + "\"\n");
+
+    // long strings with escapes at the block boundaries, both copied and decoded in situ.
+    std::string expected, escaped;
+    for (size_t i = 0; i < 70; ++i)
+    {
+        expected += ascii.substr(0, i % 35) + "\"\n\xe4\xbd\xa0";
+        escaped += ascii.substr(0, i % 35) + "\\\"\\n\\u4f60";
+    }
+    std::string text = "[\"" + escaped + "\", {\"" + escaped + "\" : \"" + ascii + "\"}]";
+
+    smartjson::Parser parser;
+    for (bool inSitu : { false, true })
+    {
+        parser.inSitu_ = inSitu;
+        TEST_EQUAL(parser.parseFromString(text));
+        TEST_EQUAL(parser.getRoot()[(size_t)0].asString()->compare(expected) == 0);
+        TEST_EQUAL(parser.getRoot()[1][expected].asString()->compare(ascii) == 0);
+
+        TEST_EQUAL(!parser.parseFromString("[\"" + escaped + "\n\"]"));
+        TEST_EQUAL(parser.getErrorCode() == smartjson::RC_INVALID_STRING);
+        TEST_EQUAL(parser.getErrorOffset() == escaped.size() + 3);
+        TEST_EQUAL(!parser.parseFromString("[\"" + escaped));
+        TEST_EQUAL(parser.getErrorCode() == smartjson::RC_INVALID_STRING);
+    }
+    parser.inSitu_ = false;
+}
+
+void testNumber()
+{
+    std::cout << "test number..." << std::endl;
+
+    smartjson::Parser parser;
+    smartjson::FastParser fastParser;
+
+    // the result must be the same as strtod, bit by bit.
+    std::vector<std::string> cases = {
+        "0.1", "1e23", "9007199254740993", "2.2250738585072011e-308", "4.9e-324",
+        "2.4703282292062327e-324", "2.4703282292062328e-324", "1.7976931348623157e308",
+        "1.7976931348623159e308", "1e-400", "123456789012345678901234567890",
+        "0.1000000000000000055511151231257827021181583404541015625",
+        "0.1000000000000000055511151231257827021181583404541015624",
+        "7.2057594037927933e16", "-0.000000000000000000000000000001234567890123456789",
+    };
+    unsigned int seed = 1;
+    char buffer[64];
+    for (int i = 0; i < 2000; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        double value = (double)seed / (1 + (seed >> 20)) * std::pow(10.0, (int)(seed % 600) - 300);
+        snprintf(buffer, sizeof(buffer), "%.17g", value);
+        cases.push_back(buffer);
+        snprintf(buffer, sizeof(buffer), "%.*e", (int)(seed % 16), value);
+        cases.push_back(buffer);
+    }
+
+    for (const std::string &text : cases)
+    {
+        double expected = strtod(text.c_str(), nullptr);
+        std::string array = "[" + text + "]";
+        TEST_EQUAL(parser.parseFromString(array));
+        double actual = parser.getRoot()[(size_t)0].asFloat();
+        TEST_EQUAL(memcmp(&actual, &expected, sizeof(expected)) == 0);
+        TEST_EQUAL(fastParser.parseFromString(array));
+        actual = fastParser.getRoot()[(size_t)0].asFloat();
+        TEST_EQUAL(memcmp(&actual, &expected, sizeof(expected)) == 0);
+    }
+
+    TEST_EQUAL(parser.parseFromString("[9223372036854775807, -9223372036854775808, 9223372036854775808]"));
+    TEST_EQUAL(parser.getRoot()[(size_t)0] == std::numeric_limits<int64_t>::max());
+    TEST_EQUAL(parser.getRoot()[(size_t)1] == std::numeric_limits<int64_t>::min());
+    TEST_EQUAL(parser.getRoot()[(size_t)2].isFloat());
+
+    // numbers may be followed by white spaces, and be used as keys.
+    TEST_EQUAL(parser.parseFromString("{1 : 2 ,\n\"a\" : [+3 ,\t-0x10\n]\n}"));
+    TEST_EQUAL(parser.getRoot()[smartjson::Node(1)] == 2);
+    TEST_EQUAL(parser.getRoot()["a"][(size_t)0] == 3);
+    TEST_EQUAL(parser.getRoot()["a"][(size_t)1] == -16);
+
+    const char *invalidCases[] = { "[01]", "[1.]", "[.5]", "[1e]", "[1e+]", "[-]", "[1x]", "[1.5.2]",
+        "[+-5]", "[+]", "[-+5]", "[++1]" };
+    smartjson::IncrementalParser incParser;
+    for (const char *text : invalidCases)
+    {
+        TEST_EQUAL(!parser.parseFromString(text));
+        TEST_EQUAL(parser.getErrorCode() == smartjson::RC_INVALID_NUMBER);
+        TEST_EQUAL(!incParser.parseFromString(text));
+        TEST_EQUAL(incParser.getErrorCode() == smartjson::RC_INVALID_NUMBER);
+    }
+}
+
+/** generate random json, which has many escape characters and nested containers. */
+void generateJson(std::string &out, unsigned int &seed, int depth)
+{
+    seed = seed * 1103515245 + 12345;
+    unsigned int r = (seed >> 16) & 0x7fff;
+    int type = depth > 4 ? r % 5 : r % 7;
+    switch (type)
+    {
+    case 0:
+        out += (r & 1) ? "true" : "null";
+        break;
+    case 1:
+        out += std::to_string((int)(r % 20000) - 10000);
+        break;
+    case 2:
+        out += std::to_string(r % 1000) + "." + std::to_string(seed % 100000);
+        if (r & 1) out += "e" + std::to_string((int)(r % 40) - 20);
+        break;
+    case 3:
+    case 4:
+    {
+        out += '"';
+        int n = r % 90;
+        for (int i = 0; i < n; ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+            unsigned int c = (seed >> 16) % 10;
+            if (c == 0) out += "\\\\";
+            else if (c == 1) out += "\\\"";
+            else if (c == 2) out += "\\u00e9";
+            else out += (char)('a' + c);
+        }
+        out += '"';
+        break;
+    }
+    case 5:
+    {
+        out += "[";
+        int n = r % 6;
+        for (int i = 0; i < n; ++i)
+        {
+            if (i > 0) out += ", ";
+            generateJson(out, seed, depth + 1);
+        }
+        out += "]";
+        break;
+    }
+    default:
+    {
+        out += "{";
+        int n = r % 6;
+        for (int i = 0; i < n; ++i)
+        {
+            if (i > 0) out += ",\n";
+            out += "\"k" + std::to_string(i) + "\\\\\" : ";
+            generateJson(out, seed, depth + 1);
+        }
+        out += "}";
+        break;
+    }
+    }
+}
+
+void testStrictParser()
+{
+    std::cout << "test strict parser..." << std::endl;
+
+    smartjson::Parser parser;
+    smartjson::StrictParser strictParser;
+
+    TEST_EQUAL(parser.parseFromData(strictJson, strlen(strictJson)));
+    TEST_EQUAL(strictParser.parseFromData(strictJson, strlen(strictJson)));
+    TEST_EQUAL(strictParser.getRoot() == parser.getRoot());
+
+    strictParser.inSitu_ = true;
+    TEST_EQUAL(strictParser.parseFromData(strictJson, strlen(strictJson)));
+    TEST_EQUAL(strictParser.getRoot() == parser.getRoot());
+    strictParser.inSitu_ = false;
+
+    // the extensions are rejected.
+    TEST_EQUAL(!strictParser.parseFromData(json, strlen(json)));
+    TEST_EQUAL(strictParser.getErrorCode() == smartjson::RC_INVALID_COMMENT);
+
+    const char *invalidCases[] = { "[0x10]", "[0o7]", "[0b1]", "[+1]", "[\"\\x41\"]", "[\"\\q\"]", "{1 : 2}", "[1, /* 2 */ 3]", "[01]" };
+    for (const char *text : invalidCases)
+    {
+        TEST_EQUAL(parser.parseFromString(text) == (text != std::string("[01]")));
+        TEST_EQUAL(!strictParser.parseFromString(text));
+    }
+
+    // the SAX path and the path filter use the same policy.
+    RecordHandler handler;
+    strictParser.setHandler(&handler);
+    TEST_EQUAL(strictParser.parseFromString("{\"a\" : [1, \"x\"]}"));
+    TEST_EQUAL(handler.text_ == "{a:[1,\"x\",]2,}1,");
+    TEST_EQUAL(!strictParser.parseFromString("{1 : 2}"));
+    TEST_EQUAL(strictParser.getErrorCode() == smartjson::RC_INVALID_KEY);
+    strictParser.setHandler(nullptr);
+
+    strictParser.setPathFilter({ "a/b" });
+    TEST_EQUAL(strictParser.parseFromString("{\"a\" : {\"b\" : 1, \"c\" : 2}}"));
+    TEST_EQUAL(strictParser.getRoot()["a"].size() == 1 && strictParser.getRoot()["a"]["b"] == 1);
+    TEST_EQUAL(!strictParser.parseFromString("{\"x\" : 0x10, \"a\" : {}}"));
+    TEST_EQUAL(strictParser.getErrorCode() == smartjson::RC_INVALID_NUMBER);
+}
+
+void testJsonLinesParser()
+{
+    std::cout << "test json lines parser..." << std::endl;
+
+    std::string text;
+    unsigned int seed = 7;
+    for (int i = 0; i < 300; ++i)
+    {
+        std::string record;
+        generateJson(record, seed, 3);
+        std::replace(record.begin(), record.end(), '\n', ' ');
+        text += record + ((i % 3 == 0) ? "\r\n" : "\n");
+        if (i % 50 == 0) text += "\n  \n// comment\n";
+    }
+
+    smartjson::Parser parser;
+    parser.jsonLines_ = true;
+    TEST_EQUAL(parser.parseFromString(text));
+    TEST_EQUAL(parser.getRoot().size() == 300);
+
+    // small batches make sure the records are split across many threads.
+    smartjson::JsonLinesParser linesParser(4);
+    linesParser.batchSize_ = 100;
+    TEST_EQUAL(linesParser.parseFromString(text));
+    TEST_EQUAL(linesParser.getRecordCount() == 300);
+    TEST_EQUAL(linesParser.getRoot() == parser.getRoot());
+
+    size_t count = 0;
+    bool inOrder = true;
+    linesParser.setCallback([&](size_t index, const smartjson::Node &record)
+    {
+        inOrder = inOrder && index == count && record == parser.getRoot()[index];
+        return ++count < 100;
+    });
+    TEST_EQUAL(!linesParser.parseFromString(text));
+    TEST_EQUAL(linesParser.getErrorCode() == smartjson::RC_HANDLER_ABORTED);
+    TEST_EQUAL(inOrder && count == 100);
+    linesParser.setCallback(nullptr);
+
+    // the error line is counted from the whole input.
+    std::string invalid = text + "[1, 2]\n{\"a\" : }\n[3]\n";
+    TEST_EQUAL(!linesParser.parseFromString(invalid));
+    TEST_EQUAL(linesParser.getErrorCode() == smartjson::RC_INVALID_NUMBER);
+    TEST_EQUAL(linesParser.getErrorLine() == (size_t)std::count(text.begin(), text.end(), '\n') + 2);
+
+    // the options of the batch parsers follow the JsonLinesParser.
+    std::string deep = "[1]\n" + std::string(50, '[') + std::string(50, ']') + "\n";
+    parser.maxDepth_ = 10;
+    linesParser.maxDepth_ = 10;
+    TEST_EQUAL(!parser.parseFromString(deep));
+    TEST_EQUAL(!linesParser.parseFromString(deep));
+    TEST_EQUAL(linesParser.getErrorCode() == smartjson::RC_TOO_DEEP && parser.getErrorCode() == smartjson::RC_TOO_DEEP);
+    TEST_EQUAL(linesParser.getErrorLine() == 2);
+    parser.maxDepth_ = 1024;
+    linesParser.maxDepth_ = 1024;
+
+    linesParser.presize_ = true;
+    TEST_EQUAL(linesParser.parseFromString("[1, 2, 3]\n{\"a\" : [4, 5]}\n"));
+    TEST_EQUAL(linesParser.getRoot()[(size_t)0].refArray().capacity() == 3);
+    TEST_EQUAL(linesParser.getRoot()[1]["a"].refArray().capacity() == 2);
+    linesParser.presize_ = false;
+
+    // a value or a comment spanning several lines fails the same way for any batch size.
+    const char *spanning[] = { "{\"a\" : 1}\n{\"b\" :\n2}\n{\"c\" : 3}\n", "[1]\n/* a\n b */\n[2]\n" };
+    for (const char *text : spanning)
+    {
+        TEST_EQUAL(!parser.parseFromString(text));
+        for (size_t batchSize : { (size_t)1, (size_t)8, (size_t)1024 * 1024 })
+        {
+            linesParser.batchSize_ = batchSize;
+            TEST_EQUAL(!linesParser.parseFromString(text));
+            TEST_EQUAL(linesParser.getErrorCode() == parser.getErrorCode());
+            TEST_EQUAL(linesParser.getErrorLine() == (size_t)parser.getLine());
+        }
+    }
+    TEST_EQUAL(parser.getErrorCode() == smartjson::RC_INVALID_COMMENT);
+    linesParser.batchSize_ = 100;
+
+    TEST_EQUAL(!linesParser.parseFromString("1 2\n"));
+    TEST_EQUAL(linesParser.parseFromString(""));
+    TEST_EQUAL(linesParser.getRoot().size() == 0);
+}
+
+void testLazyParser()
+{
+    std::cout << "test lazy parser..." << std::endl;
+
+    smartjson::Parser parser;
+    TEST_EQUAL(parser.parseFromData(json, strlen(json)));
+    smartjson::Node expected = parser.getRoot();
+
+    smartjson::LazyParser lazyParser;
+    smartjson::SourceBuffer *buffer = smartjson::SourceBuffer::createFromData(json, strlen(json));
+    buffer->retain();
+    TEST_EQUAL(lazyParser.parse(buffer));
+    {
+        smartjson::Node root = lazyParser.getRoot();
+        TEST_EQUAL(root.isDict());
+        // only the root is recorded, nothing was created yet.
+        TEST_EQUAL(buffer->getRefCount() == 2);
+
+        // the root is expanded, 'array' and 'pos' are still recorded as ranges.
+        TEST_EQUAL(root["name"] == "json");
+        TEST_EQUAL(root["s3"] == "ab\t\r\n\"\\cd");
+        TEST_EQUAL(buffer->getRefCount() == 3);
+
+        TEST_EQUAL(root.findMemberByPath("pos/x", 5) == 100.55);
+        TEST_EQUAL(root["array"].size() == 8);
+        TEST_EQUAL(buffer->getRefCount() == 1);
+        TEST_EQUAL(root == expected);
+    }
+    TEST_EQUAL(lazyParser.parse(buffer));
+    {
+        // drop an unexpanded tree.
+        smartjson::Node root = lazyParser.getRoot();
+        TEST_EQUAL(root["age"] == 20);
+        TEST_EQUAL(buffer->getRefCount() == 3);
+    }
+    TEST_EQUAL(lazyParser.parseFromString("[]"));
+    TEST_EQUAL(buffer->getRefCount() == 1);
+    buffer->release();
+
+    // the source is copied and outlives the input string.
+    std::string text;
+    unsigned int seed = 5;
+    generateJson(text, seed, 0);
+    smartjson::Node root;
+    {
+        std::string input = "[" + text + ", [1, \"]\\\"[\", /* ] */ {\"a\" : [2]}], {}, [], // ]\n 3]";
+        TEST_EQUAL(parser.parseFromString(input));
+        expected = parser.getRoot();
+        TEST_EQUAL(lazyParser.parseFromString(input));
+        root = lazyParser.getRoot();
+        input.assign(input.size(), ' ');
+    }
+    TEST_EQUAL(root[(size_t)1][(size_t)2]["a"][(size_t)0] == 2);
+    smartjson::Node copy = root.deepClone();
+    TEST_EQUAL(root.size() == 5);
+    TEST_EQUAL(copy == expected);
+    TEST_EQUAL(root == expected);
+
+    smartjson::Node member = lazyParser.parseFromString("{\"a\" : {\"b\" : 1}}") ? lazyParser.getRoot()["a"] : smartjson::Node();
+    member.setMember("c", 2);
+    TEST_EQUAL(member.size() == 2 && member["b"] == 1);
+
+    // the structure is validated up front.
+    const char *invalid = "{\"a\" : [1, 2,],\n \"b\" : 3}";
+    TEST_EQUAL(!parser.parseFromString(invalid));
+    TEST_EQUAL(!lazyParser.parseFromString(invalid));
+    TEST_EQUAL(lazyParser.getErrorCode() == parser.getErrorCode());
+    TEST_EQUAL(lazyParser.getLine() == parser.getLine() && lazyParser.getColumn() == parser.getColumn());
+    TEST_EQUAL(!lazyParser.parseFromString("[1] 2"));
+    TEST_EQUAL(!lazyParser.parseFromString("[\"abc]"));
+}
+
+void testParallelParser()
+{
+    std::cout << "test parallel parser..." << std::endl;
+
+    std::string array = "[";
+    std::string dict = "{";
+    unsigned int seed = 11;
+    for (int i = 0; i < 300; ++i)
+    {
+        std::string value;
+        generateJson(value, seed, 2);
+        if (i != 0)
+        {
+            array += ",\n";
+            dict += ",\n";
+        }
+        array += value;
+        // duplicate keys and int keys must be merged in the original order.
+        dict += (i % 7 == 0) ? "\"k/" + std::to_string(i % 5) + "\"" :
+            (i % 11 == 0) ? std::to_string(i % 3) :
+            "\"k" + std::to_string(i % 50) + "\"";
+        dict += " : " + value;
+    }
+    array += "]";
+    dict += "}";
+
+    smartjson::Parser parser;
+    smartjson::ParallelParser parallelParser(4);
+    parallelParser.minParallelSize_ = 0;
+    parallelParser.minChunkSize_ = 100;
+
+    TEST_EQUAL(parser.parseFromString(array));
+    TEST_EQUAL(parallelParser.parseFromString(array));
+    TEST_EQUAL(parallelParser.isParallel());
+    TEST_EQUAL(parallelParser.getRoot() == parser.getRoot());
+
+    TEST_EQUAL(parser.parseFromString(dict));
+    TEST_EQUAL(parallelParser.parseFromString(dict));
+    TEST_EQUAL(parallelParser.isParallel());
+    TEST_EQUAL(parallelParser.getRoot() == parser.getRoot());
+
+    // comments fall back to the sequential parser.
+    std::string commented = "[/* comment, [ */" + array.substr(1);
+    TEST_EQUAL(parallelParser.parseFromString(commented));
+    TEST_EQUAL(!parallelParser.isParallel());
+    TEST_EQUAL(parser.parseFromString(array));
+    TEST_EQUAL(parallelParser.getRoot() == parser.getRoot());
+
+    // the path filter falls back to the sequential parser.
+    std::string filtered = "{\"keep\" : 1";
+    for (int i = 0; i < 100000; ++i)
+    {
+        filtered += ", \"k" + std::to_string(i) + "\" : [" + std::to_string(i) + "]";
+    }
+    filtered += "}";
+    parallelParser.setPathFilter({ "keep" });
+    TEST_EQUAL(parallelParser.parseFromString(filtered));
+    TEST_EQUAL(!parallelParser.isParallel());
+    TEST_EQUAL(parallelParser.getRoot().size() == 1 && parallelParser.getRoot()["keep"] == 1);
+    parallelParser.setPathFilter({});
+
+    // the depth limit counts the root container.
+    parallelParser.maxDepth_ = 1;
+    TEST_EQUAL(!parallelParser.parseFromString(array));
+    TEST_EQUAL(parallelParser.getErrorCode() == smartjson::RC_TOO_DEEP);
+    std::string flat = "[1";
+    for (int i = 0; i < 1000; ++i)
+    {
+        flat += ", " + std::to_string(i);
+    }
+    flat += "]";
+    TEST_EQUAL(parallelParser.parseFromString(flat));
+    TEST_EQUAL(parallelParser.isParallel());
+    parallelParser.maxDepth_ = 2;
+    TEST_EQUAL(parallelParser.parseFromString("[" + flat + ", " + flat + "]"));
+    TEST_EQUAL(parallelParser.isParallel());
+    TEST_EQUAL(!parallelParser.parseFromString("[" + flat + ", [" + flat + "]]"));
+    TEST_EQUAL(parallelParser.getErrorCode() == smartjson::RC_TOO_DEEP);
+    parallelParser.maxDepth_ = 1024;
+
+    // presize_ reserves the containers inside every chunk.
+    std::string nested = "{\"a\" : " + flat + ", \"b\" : {\"c\" : " + flat + "}, \"d\" : []}";
+    parallelParser.presize_ = true;
+    TEST_EQUAL(parallelParser.parseFromString(nested));
+    TEST_EQUAL(parallelParser.isParallel());
+    TEST_EQUAL(parallelParser.getRoot()["a"].refArray().capacity() == 1001);
+    TEST_EQUAL(parallelParser.getRoot()["b"]["c"].refArray().capacity() == 1001);
+    TEST_EQUAL(parallelParser.getRoot()["d"].refArray().capacity() == 0);
+    TEST_EQUAL(parser.parseFromString(nested) && parallelParser.getRoot() == parser.getRoot());
+    parallelParser.presize_ = false;
+
+    // invalid UTF-8 is found inside the chunks.
+    std::string badUTF8 = array.substr(0, array.size() - 1) + ", \"a\xff" "b\"]";
+    TEST_EQUAL(parallelParser.parseFromString(badUTF8));
+    parallelParser.validateUTF8_ = true;
+    parser.validateUTF8_ = true;
+    TEST_EQUAL(parallelParser.parseFromString(array));
+    TEST_EQUAL(parallelParser.isParallel());
+    TEST_EQUAL(!parser.parseFromString(badUTF8));
+    TEST_EQUAL(!parallelParser.parseFromString(badUTF8));
+    TEST_EQUAL(parallelParser.getErrorCode() == smartjson::RC_INVALID_UTF8);
+    TEST_EQUAL(parallelParser.getErrorOffset() == parser.getErrorOffset());
+    parallelParser.validateUTF8_ = false;
+    parser.validateUTF8_ = false;
+
+    // errors are reported by the sequential parser with the exact position.
+    std::string invalid = array.substr(0, array.size() / 2) + ", tru, " + array.substr(array.size() / 2);
+    TEST_EQUAL(!parser.parseFromString(invalid));
+    TEST_EQUAL(!parallelParser.parseFromString(invalid));
+    TEST_EQUAL(parallelParser.getErrorCode() == parser.getErrorCode());
+    TEST_EQUAL(parallelParser.getLine() == parser.getLine());
+    TEST_EQUAL(parallelParser.getColumn() == parser.getColumn());
+
+    TEST_EQUAL(!parallelParser.parseFromString(array + " 1"));
+    TEST_EQUAL(!parallelParser.parseFromString(array + "]"));
+    TEST_EQUAL(!parallelParser.parseFromString("[1,,2]"));
+    TEST_EQUAL(parallelParser.parseFromString("[1, \"a,]\\\"b\", 2]"));
+    TEST_EQUAL(parallelParser.getRoot().size() == 3);
+    TEST_EQUAL(parallelParser.getRoot()[(size_t)1] == "a,]\"b");
+    TEST_EQUAL(parallelParser.parseFromString("[]"));
+    TEST_EQUAL(parallelParser.getRoot().isArray() && parallelParser.getRoot().size() == 0);
+}
+
+void testFastParser()
+{
+    std::cout << "test fast parser..." << std::endl;
+
+    smartjson::Parser parser;
+    smartjson::FastParser fastParser;
+
+    TEST_EQUAL(parser.parseFromData(strictJson, strlen(strictJson)));
+    TEST_EQUAL(fastParser.parseFromData(strictJson, strlen(strictJson)));
+    TEST_EQUAL(fastParser.getRoot() == parser.getRoot());
+    TEST_EQUAL(fastParser.getRoot()["s2"] == "\xe4\xbd\xa0\xe5\xa5\xbd\xf0\x9f\x98\x80");
+    TEST_EQUAL(fastParser.getRoot()["s4"] == "\\\\\"\\");
+
+    fastParser.inSitu_ = true;
+    TEST_EQUAL(fastParser.parseFromData(strictJson, strlen(strictJson)));
+    TEST_EQUAL(fastParser.getRoot() == parser.getRoot());
+    fastParser.inSitu_ = false;
+
+    // random documents cover escape sequences crossing the 64 bytes block boundary.
+    unsigned int seed = 1;
+    for (int i = 0; i < 200; ++i)
+    {
+        std::string text = "[";
+        generateJson(text, seed, 0);
+        text += "]";
+
+        TEST_EQUAL(parser.parseFromString(text));
+        TEST_EQUAL(fastParser.parseFromString(text));
+        TEST_EQUAL(fastParser.getRoot() == parser.getRoot());
+    }
+
+    const char *invalidCases[] = {
+        "", "[", "]", "[1,]", "[1 2]", "{\"a\" 1}", "{1 : 2}", "[\"abc]", "[tru]", "[truex]",
+        "[nul]", "[1.]", "[-]", "[1e]", "[01x]", "{\"a\":1,}", "[1] 2", "[\"a\\\"]",
+    };
+    for (const char *text : invalidCases)
+    {
+        TEST_EQUAL(!fastParser.parseFromString(text));
+        TEST_EQUAL(fastParser.getErrorCode() != smartjson::RC_OK);
+    }
+
+    // unknown escapes are rejected like StrictParser does.
+    for (const char *text : { "[\"\\q\"]", "[\"abc\\x41\"]", "{\"\\'\" : 1}" })
+    {
+        TEST_EQUAL(!fastParser.parseFromString(text));
+        TEST_EQUAL(fastParser.getErrorCode() == smartjson::RC_INVALID_CHAR);
+        smartjson::StrictParser strictParser;
+        TEST_EQUAL(!strictParser.parseFromString(text));
+        TEST_EQUAL(strictParser.getErrorCode() == smartjson::RC_INVALID_CHAR);
+    }
+
+    TEST_EQUAL(fastParser.parseFromString(" 123 "));
+    TEST_EQUAL(fastParser.getRoot() == 123);
+
+    // containers are reserved once with the exact element count.
+    std::string big = "{\"s\" : \"[,{\\\"]\", \"e\" : [], \"d\" : {}, \"a\" : [";
+    for (int i = 0; i < 1000; ++i)
+    {
+        big += (i > 0 ? ", [" : "[") + std::to_string(i) + ", \"],\"]";
+    }
+    big += "], \"m\" : {";
+    for (int i = 0; i < 500; ++i)
+    {
+        big += (i > 0 ? ", \"k" : "\"k") + std::to_string(i) + "\" : " + std::to_string(i);
+    }
+    big += "}}";
+
+    smartjson::Dict reserved;
+    reserved.reserve(500);
+
+    TEST_EQUAL(parser.parseFromString(big));
+    smartjson::Node expected = parser.getRoot();
+    TEST_EQUAL(expected["a"].refArray().capacity() != 1000);
+    parser.presize_ = true;
+    fastParser.presize_ = true;
+    TEST_EQUAL(parser.parseFromString("{/* [1, 2] */ // [,]\n" + big.substr(1)));
+    TEST_EQUAL(fastParser.parseFromString(big));
+    for (const smartjson::IParser *p : { (smartjson::IParser*)&parser, (smartjson::IParser*)&fastParser })
+    {
+        smartjson::Node root = p->getRoot();
+        TEST_EQUAL(root == expected);
+        TEST_EQUAL(root.size() == 5 && root["a"].refArray().capacity() == 1000);
+        TEST_EQUAL(root["a"][999].refArray().capacity() == 2);
+        TEST_EQUAL(root["e"].refArray().capacity() == 0);
+        TEST_EQUAL(root["m"].refDict().bucket_count() == reserved.bucket_count());
+    }
+    TEST_EQUAL(!parser.parseFromString("[[1, 2], [3,]"));
+    TEST_EQUAL(!fastParser.parseFromString("[[1, 2], [3,]"));
+}
+
+void testMinify()
+{
+    std::cout << "test minify..." << std::endl;
+
+    const char *text = R"({
+    // line comment with "quote
+    "a" : [1, 2, 3, ],   /* block "comment" */
+    "s" : "keep // this /* and */ \" , ]",
+    "e" : "\\",
+    "o" : { "x" : null, }, /**/
+}
+)";
+    const char *expected = R"({"a":[1,2,3],"s":"keep // this /* and */ \" , ]","e":"\\","o":{"x":null}})";
+
+    std::string output;
+    // comments and strings are found at any offset of the 64 bytes blocks.
+    for (size_t n = 0; n < 130; ++n)
+    {
+        TEST_EQUAL(smartjson::minify(std::string(n, ' ') + text, output) && output == expected);
+        TEST_EQUAL(smartjson::minify(std::string(n, ' ') + "\"" + std::string(n, 'a') + "\" // end", output));
+        TEST_EQUAL(output == "\"" + std::string(n, 'a') + "\"");
+    }
+
+    TEST_EQUAL(smartjson::minify("", output) && output.empty());
+    TEST_EQUAL(!smartjson::minify("[\"abc]", output));
+    TEST_EQUAL(!smartjson::minify("[\"abc\\", output));
+    TEST_EQUAL(!smartjson::minify("[1] /* abc *", output));
+    TEST_EQUAL(!smartjson::minify("[1] / 2", output));
+
+    // pretty printed documents with comments and trailing commas are minified to the same values.
+    smartjson::Parser parser;
+    smartjson::Writer writer, plainWriter;
+    writer.endComma_ = true;
+    unsigned int seed = 3;
+    for (int i = 0; i < 100; ++i)
+    {
+        std::string json = "[";
+        generateJson(json, seed, 0);
+        json += "]";
+        TEST_EQUAL(parser.parseFromString(json));
+        smartjson::Node root = parser.getRoot();
+
+        // the floats are compared after being printed by the writer.
+        std::string pretty = writer.toString(root);
+        TEST_EQUAL(parser.parseFromString(plainWriter.toString(root)));
+        root = parser.getRoot();
+
+        std::string commented;
+        for (char ch : pretty)
+        {
+            commented += ch == '\n' ? std::string(" /* c */ // c\n") : std::string(1, ch);
+        }
+
+        TEST_EQUAL(smartjson::minify(commented, output));
+        TEST_EQUAL(parser.parseFromString(output) && parser.getRoot() == root);
+
+        std::string again;
+        TEST_EQUAL(smartjson::minify(output, again) && again == output);
+    }
+}
+
+void testSimdDispatch()
+{
+    std::cout << "test simd dispatch..." << std::endl;
+
+    unsigned cpuFeatures = smartjson::getCpuFeatures();
+    TEST_EQUAL(smartjson::getSimdFeatures() == cpuFeatures);
+
+    // every kernel level gives the same results, from the forced scalar fallback to the widest one.
+    for (unsigned features : { 0u, (unsigned)smartjson::CPU_SSE2, (unsigned)(smartjson::CPU_SSE2 | smartjson::CPU_AVX2),
+        (unsigned)smartjson::CPU_NEON, (unsigned)smartjson::CPU_ALL })
+    {
+        smartjson::setSimdFeatures(features);
+        TEST_EQUAL(smartjson::getSimdFeatures() == (features & cpuFeatures));
+
+        testStringScan();
+        testUTF8();
+        testFastParser();
+        testMinify();
+    }
+
+    smartjson::setSimdFeatures(smartjson::CPU_ALL);
+    TEST_EQUAL(smartjson::getSimdFeatures() == cpuFeatures);
+}
+
+void testOutputSink()
+{
+    std::cout << "test output sink..." << std::endl;
+
+    smartjson::Parser parser;
+    TEST_EQUAL(parser.parseFromData(json, strlen(json)));
+    smartjson::Node root = parser.getRoot();
+    root.setMember("long", smartjson::Node(std::string(200000, 'x')));
+
+    smartjson::Writer writer;
+    std::string expected = writer.toString(root);
+    TEST_EQUAL(expected.size() > 200000);
+
+    // the memory sink grows from a tiny buffer.
+    smartjson::MemorySink memory(16);
+    TEST_EQUAL(writer.write(root, memory));
+    TEST_EQUAL(memory.str() == expected);
+
+    std::ostringstream stream;
+    TEST_EQUAL(writer.write(root, stream) && stream.str() == expected);
+
+    // a fixed buffer keeps what fits and reports the overflow.
+    std::vector<char> buffer(1000);
+    smartjson::FixedBufferSink fixed(buffer.data(), buffer.size());
+    TEST_EQUAL(!writer.write(root, fixed));
+    TEST_EQUAL(writer.getErrorCode() == smartjson::RC_WRITE_ERROR);
+    TEST_EQUAL(fixed.size() == 1000 && memcmp(fixed.data(), expected.data(), 1000) == 0);
+    fixed.clear();
+    TEST_EQUAL(writer.write(smartjson::Node("abc"), fixed));
+    TEST_EQUAL(std::string(fixed.data(), fixed.size()) == "\"abc\"\n");
+
+    // large writes go straight to the file.
+    const char *fileName = "test_sink.json";
+    TEST_EQUAL(writer.writeToFile(root, fileName));
+    std::ifstream file(fileName, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    TEST_EQUAL(content == expected);
+    file.close();
+    TEST_EQUAL(std::remove(fileName) == 0);
+
+    // the binary format stores string lengths in 16 bits.
+    TEST_EQUAL(parser.parseFromData(json, strlen(json)));
+    smartjson::BinaryWriter binaryWriter;
+    smartjson::MemorySink binary;
+    TEST_EQUAL(binaryWriter.write(parser.getRoot(), binary));
+    smartjson::BinaryParser binaryParser;
+    TEST_EQUAL(binaryParser.parseFromData(binary.data(), binary.size()));
+    TEST_EQUAL(binaryParser.getRoot() == parser.getRoot());
+
+    TEST_EQUAL(!writer.writeToFile(root, "no_such_dir/test_sink.json"));
+    TEST_EQUAL(writer.getErrorCode() == smartjson::RC_OPEN_FILE_ERROR);
+}
+
+void testNumberFormat()
+{
+    std::cout << "test number format..." << std::endl;
+
+    char buffer[smartjson::MAX_NUMBER_LENGTH];
+    auto formatInt = [&](int64_t v){
+        return std::string(buffer, smartjson::formatInteger(buffer, v));
+    };
+    auto formatDouble = [&](double v){
+        return std::string(buffer, smartjson::formatFloat(buffer, v));
+    };
+    auto formatSingle = [&](float v){
+        return std::string(buffer, smartjson::formatFloat(buffer, v));
+    };
+
+    TEST_EQUAL(formatInt(0) == "0");
+    TEST_EQUAL(formatInt(7) == "7");
+    TEST_EQUAL(formatInt(-10) == "-10");
+    TEST_EQUAL(formatInt(123456789) == "123456789");
+    TEST_EQUAL(formatInt(std::numeric_limits<int64_t>::max()) == "9223372036854775807");
+    TEST_EQUAL(formatInt(std::numeric_limits<int64_t>::min()) == "-9223372036854775808");
+    TEST_EQUAL(std::string(buffer, smartjson::formatUInteger(buffer, std::numeric_limits<uint64_t>::max())) == "18446744073709551615");
+
+    // shortest digits, integral values keep ".0".
+    TEST_EQUAL(formatDouble(0.0) == "0.0");
+    TEST_EQUAL(formatDouble(-0.0) == "-0.0");
+    TEST_EQUAL(formatDouble(1.0) == "1.0");
+    TEST_EQUAL(formatDouble(-2.5) == "-2.5");
+    TEST_EQUAL(formatDouble(0.1) == "0.1");
+    TEST_EQUAL(formatDouble(0.1 + 0.2) == "0.30000000000000004");
+    TEST_EQUAL(formatDouble(123456.789) == "123456.789");
+    TEST_EQUAL(formatDouble(0.000001) == "0.000001");
+    TEST_EQUAL(formatDouble(1e-7) == "1e-7");
+    TEST_EQUAL(formatDouble(1.5e-7) == "1.5e-7");
+    TEST_EQUAL(formatDouble(1e20) == "100000000000000000000.0");
+    TEST_EQUAL(formatDouble(1e21) == "1e21");
+    TEST_EQUAL(formatDouble(1.2345e30) == "1.2345e30");
+    TEST_EQUAL(formatDouble(5e-324) == "5e-324");
+    TEST_EQUAL(formatDouble(std::numeric_limits<double>::max()) == "1.7976931348623157e308");
+    TEST_EQUAL(formatDouble(std::numeric_limits<double>::min()) == "2.2250738585072014e-308");
+    TEST_EQUAL(formatDouble(std::numeric_limits<double>::infinity()) == "inf");
+    TEST_EQUAL(formatDouble(-std::numeric_limits<double>::infinity()) == "-inf");
+    TEST_EQUAL(formatDouble(std::numeric_limits<double>::quiet_NaN()) == "nan");
+
+    TEST_EQUAL(formatSingle(0.1f) == "0.1");
+    TEST_EQUAL(formatSingle(3.14159f) == "3.14159");
+    TEST_EQUAL(formatSingle(16777216.0f) == "16777216.0");
+    TEST_EQUAL(formatSingle(std::numeric_limits<float>::max()) == "3.4028235e38");
+    TEST_EQUAL(formatSingle(std::numeric_limits<float>::denorm_min()) == "1e-45");
+
+    // random bit patterns must read back to the same value.
+    std::mt19937_64 random(20161);
+    for (int i = 0; i < 100000; ++i)
+    {
+        uint64_t bits = random();
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        if (std::isfinite(d))
+        {
+            std::string text = formatDouble(d);
+            TEST_EQUAL(text.size() <= 25 && strtod(text.c_str(), nullptr) == d);
+        }
+
+        uint32_t bits32 = (uint32_t)bits;
+        float f;
+        memcpy(&f, &bits32, sizeof(f));
+        if (std::isfinite(f))
+        {
+            std::string text = formatSingle(f);
+            TEST_EQUAL(text.size() <= 25 && strtof(text.c_str(), nullptr) == f);
+        }
+    }
+
+    // the writer output parses back to the same tree.
+    const char *numbers = "[0, -1, 9007199254740993, 0.1, -2.5e-8, 1e21, 3.0, 1234.5678]";
+    smartjson::Parser parser;
+    TEST_EQUAL(parser.parseFromData(numbers, strlen(numbers)));
+    smartjson::Writer writer;
+    std::string text = writer.toString(parser.getRoot());
+    smartjson::Node root = parser.getRoot();
+    smartjson::Parser parser2;
+    TEST_EQUAL(parser2.parseFromData(text.data(), text.size()));
+    TEST_EQUAL(parser2.getRoot() == root);
+    TEST_EQUAL(parser2.getRoot()[6].isFloat());
+
+    std::ostringstream stream;
+    stream << smartjson::Node(0.5) << " " << smartjson::Node(-42);
+    TEST_EQUAL(stream.str() == "0.5 -42");
+}
+
+void testMaxDepth()
+{
+    std::cout << "test max depth..." << std::endl;
+
+    const size_t depth = 10000;
+    std::string deep;
+    for (size_t i = 0; i < depth; ++i)
+    {
+        deep += (i % 2 == 0) ? "[1, " : "{\"a\" : ";
+    }
+    deep += "null";
+    for (size_t i = depth; i > 0; --i)
+    {
+        deep += ((i - 1) % 2 == 0) ? "]" : "}";
+    }
+
+    // the default limit rejects the document instead of overflowing the stack.
+    smartjson::Parser parser;
+    TEST_EQUAL(!parser.parseFromString(deep));
+    TEST_EQUAL(parser.getErrorCode() == smartjson::RC_TOO_DEEP);
+
+    parser.maxDepth_ = depth;
+    TEST_EQUAL(parser.parseFromString(deep));
+    smartjson::Node node = parser.getRoot();
+    size_t count = 0;
+    while (node.isArray() || node.isDict())
+    {
+        node = node.isArray() ? node[(size_t)1] : node["a"];
+        ++count;
+    }
+    TEST_EQUAL(count == depth && node.isNull());
+
+    // the container stack is reused, and released on errors.
+    TEST_EQUAL(!parser.parseFromString(deep.substr(0, deep.size() - 1)));
+    TEST_EQUAL(parser.parseFromData(json, strlen(json)));
+
+    RecordHandler handler;
+    parser.setHandler(&handler);
+    parser.maxDepth_ = 100;
+    TEST_EQUAL(!parser.parseFromString(deep));
+    TEST_EQUAL(parser.getErrorCode() == smartjson::RC_TOO_DEEP);
+    parser.setHandler(nullptr);
+
+    smartjson::FastParser fastParser;
+    fastParser.maxDepth_ = 100;
+    TEST_EQUAL(!fastParser.parseFromString(deep));
+    TEST_EQUAL(fastParser.getErrorCode() == smartjson::RC_TOO_DEEP);
+    fastParser.maxDepth_ = depth;
+    parser.maxDepth_ = depth;
+    TEST_EQUAL(fastParser.parseFromString(deep));
+    TEST_EQUAL(parser.parseFromString(deep) && fastParser.getRoot() == parser.getRoot());
+
+    // the SAX path and skipValue keep their containers off the call stack too.
+    std::string veryDeep = std::string(1000000, '[') + std::string(1000000, ']');
+    smartjson::IHandler nullHandler;
+    parser.setHandler(&nullHandler);
+    parser.maxDepth_ = 1000000;
+    TEST_EQUAL(parser.parseFromString(veryDeep));
+    parser.setHandler(nullptr);
+    parser.setPathFilter({ "a" });
+    TEST_EQUAL(parser.parseFromString("{\"b\" : " + veryDeep + ", \"a\" : 1}"));
+    TEST_EQUAL(parser.getRoot().size() == 1 && parser.getRoot()["a"] == 1);
+    parser.setPathFilter({});
+
+    smartjson::IncrementalParser incParser;
+    incParser.maxDepth_ = 100;
+    TEST_EQUAL(!incParser.parseFromString(deep));
+    TEST_EQUAL(incParser.getErrorCode() == smartjson::RC_TOO_DEEP);
+
+    smartjson::JsonReader reader;
+    reader.maxDepth_ = 100;
+    reader.open(deep.data(), deep.size());
+    while (reader.next() != smartjson::JsonReader::TK_END)
+    {
+    }
+    TEST_EQUAL(reader.getErrorCode() == smartjson::RC_TOO_DEEP);
+
+    // binary data nested deeper than the limit.
+    std::string shallow;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        shallow += "[1, ";
+    }
+    shallow += "2" + std::string(1000, ']');
+    parser.maxDepth_ = 1000;
+    TEST_EQUAL(parser.parseFromString(shallow));
+    smartjson::BinaryWriter writer;
+    std::string data = writer.toString(parser.getRoot());
+
+    smartjson::BinaryParser binaryParser;
+    TEST_EQUAL(binaryParser.parseFromString(data));
+    TEST_EQUAL(binaryParser.getRoot() == parser.getRoot());
+    binaryParser.maxDepth_ = 999;
+    TEST_EQUAL(!binaryParser.parseFromString(data));
+    TEST_EQUAL(binaryParser.getErrorCode() == smartjson::RC_TOO_DEEP);
+}
+
 void testBinaryParser()
 {
     std::cout << "test binary parser ..." << std::endl;
@@ -283,6 +1834,11 @@ void testBinaryParser()
     std::cout << "parse from binary data: " << std::endl;
     jWriter.write(bParser.getRoot(), std::cout);
 
+    // truncated data must be rejected instead of reading out of range.
+    ret = bParser.parseFromData(data.data(), data.size() / 2);
+    TEST_EQUAL(!ret);
+    TEST_EQUAL(bParser.getErrorOffset() <= data.size() / 2);
+
     const char *fileName = "test_sheet.ab";
     if(bParser.parseFromFile(fileName))
     {
@@ -305,7 +1861,27 @@ int main(int argc, const char * argv[]) {
     testString();
     testNode();
     testParser();
+    testParseInto();
+    testNumber();
+    testUTF8();
+    testStringScan();
+    testPathFilter();
+    testInSituParser();
+    testLazyParser();
+    testSaxHandler();
+    testJsonReader();
+    testBinding();
+    testIncrementalParser();
+    testFastParser();
+    testSimdDispatch();
+    testStrictParser();
+    testMinify();
+    testJsonLinesParser();
+    testParallelParser();
     testBinaryParser();
+    testOutputSink();
+    testNumberFormat();
+    testMaxDepth();
     
     std::cout << "test finished." << std::endl;
     return 0;